@@ -0,0 +1,82 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Zhenkai Zhu <zhenkai@cs.ucla.edu>
+ *         Chaoyi Bian <bcy@pku.edu.cn>
+ *	   Alexander Afanasyev <alexander.afanasyev@ucla.edu>
+ */
+
+#include "sync-change-index.h"
+
+#include <boost/foreach.hpp>
+#include <boost/assert.hpp>
+
+namespace Sync {
+
+ChangeIndex::ChangeIndex ()
+{
+}
+
+void
+ChangeIndex::record (const DiffState &diff, uint64_t step)
+{
+  Changes::index<ordered>::type &byStep = m_changes.get<ordered> ();
+  BOOST_ASSERT (byStep.empty () || byStep.back ().m_step <= step);
+
+  BOOST_FOREACH (const DiffLeafPtr &leaf, diff.getLeaves ())
+    {
+      std::pair<Changes::iterator, bool> item = m_changes.insert (Change (leaf, step));
+      if (!item.second)
+        {
+          m_changes.modify (item.first, Update (leaf, step));
+          byStep.relocate (byStep.end (), m_changes.project<ordered> (item.first));
+        }
+    }
+}
+
+void
+ChangeIndex::collect (uint64_t step, DiffState &result) const
+{
+  const Changes::index<ordered>::type &byStep = m_changes.get<ordered> ();
+  for (Changes::index<ordered>::type::const_reverse_iterator change = byStep.rbegin ();
+       change != byStep.rend () && change->m_step > step;
+       change++)
+    {
+      if (change->m_leaf->getOperation () == UPDATE)
+        result.update (change->m_leaf->getInfo (), change->m_leaf->getSeq ());
+      else
+        result.remove (change->m_leaf->getInfo ());
+    }
+}
+
+void
+ChangeIndex::prune (uint64_t step)
+{
+  Changes::index<ordered>::type &byStep = m_changes.get<ordered> ();
+  while (!byStep.empty () && byStep.front ().m_step <= step)
+    byStep.pop_front ();
+}
+
+size_t
+ChangeIndex::getMemoryUsage () const
+{
+  // a node with the change, pointers of both indices and a hash bucket, plus the leaf
+  // and its control block (leaves are usually not shared with anything else)
+  return m_changes.size () * (sizeof (Change) + 4 * sizeof (void*) + sizeof (DiffLeaf) + 2 * sizeof (long));
+}
+
+} // Sync
@@ -0,0 +1,139 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Zhenkai Zhu <zhenkai@cs.ucla.edu>
+ *         Chaoyi Bian <bcy@pku.edu.cn>
+ *	   Alexander Afanasyev <alexander.afanasyev@ucla.edu>
+ */
+
+#ifndef SYNC_CHANGE_INDEX_H
+#define SYNC_CHANGE_INDEX_H
+
+#include "sync-diff-state.h"
+#include "sync-state-leaf-container.h"
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/sequenced_index.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/mem_fun.hpp>
+
+namespace mi = boost::multi_index;
+
+namespace Sync {
+
+/**
+ * \ingroup sync
+ * @brief Index of the latest change of every name, ordered by time of the change
+ *
+ * Every diff that is added to the log of diffs is assigned the next step
+ * number and its leaves are recorded in the index (replacing older changes of
+ * the same names).  All changes made after a given step (i.e., the same as
+ * applying all later diffs one after another) can then be collected in time
+ * proportional to the number of changed names, independent of how many diffs
+ * have been made since that step.
+ *
+ * Memory usage is proportional to the number of names changed after the
+ * oldest step that can still be requested (see prune ())
+ */
+class ChangeIndex
+{
+public:
+  ChangeIndex ();
+
+  /**
+   * @brief Record all leaves of the diff as changed at the step
+   * @param diff differential state
+   * @param step step number (should be larger than of all previously recorded diffs)
+   */
+  void
+  record (const DiffState &diff, uint64_t step);
+
+  /**
+   * @brief Collect the latest changes of all names that have been changed after the step
+   * @param step step number
+   * @param result differential state to put changes to
+   */
+  void
+  collect (uint64_t step, DiffState &result) const;
+
+  /**
+   * @brief Remove changes made at or before the step
+   * @param step the oldest step that can still be passed to collect ()
+   */
+  void
+  prune (uint64_t step);
+
+  /**
+   * @brief Number of names in the index
+   */
+  size_t
+  size () const { return m_changes.size (); }
+
+  /**
+   * @brief Get approximate amount of memory used by the index, including the recorded leaves
+   */
+  size_t
+  getMemoryUsage () const;
+
+private:
+  struct Change
+  {
+    Change (const DiffLeafPtr &leaf, uint64_t step) : m_leaf (leaf), m_step (step) { }
+
+    const NameInfoConstPtr &
+    getInfo () const { return m_leaf->getInfo (); }
+
+    DiffLeafPtr m_leaf;
+    uint64_t m_step;
+  };
+
+  struct Update
+  {
+    Update (const DiffLeafPtr &leaf, uint64_t step) : m_leaf (leaf), m_step (step) { }
+
+    void
+    operator () (Change &change) const
+    {
+      change.m_leaf = m_leaf;
+      change.m_step = m_step;
+    }
+
+    const DiffLeafPtr &m_leaf;
+    uint64_t m_step;
+  };
+
+  typedef mi::multi_index_container<
+    Change,
+    mi::indexed_by<
+      mi::hashed_unique<
+        mi::tag<hashed>,
+        mi::const_mem_fun<Change, const NameInfoConstPtr &, &Change::getInfo>,
+        NameInfoHash,
+        NameInfoEqual
+        >,
+      // changes in order of steps (the latest is at the end)
+      mi::sequenced<mi::tag<ordered> >
+      >
+    > Changes;
+
+  Changes m_changes;
+};
+
+} // Sync
+
+#endif // SYNC_CHANGE_INDEX_H
@@ -0,0 +1,96 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Zhenkai Zhu <zhenkai@cs.ucla.edu>
+ *         Chaoyi Bian <bcy@pku.edu.cn>
+ *	   Alexander Afanasyev <alexander.afanasyev@ucla.edu>
+ */
+
+#include "sync-diff-history.h"
+
+#include <boost/assert.hpp>
+
+namespace Sync {
+
+static const size_t INITIAL_CAPACITY = 16;
+
+DiffHistory::DiffHistory ()
+  : m_first (0)
+  , m_size (0)
+  , m_lastStep (0)
+{
+}
+
+uint64_t
+DiffHistory::push (const DigestValue &digest)
+{
+  if (m_size == m_steps.size ())
+    grow ();
+
+  m_steps [(m_first + m_size) % m_steps.size ()] = digest;
+  m_size ++;
+  m_lastStep ++;
+
+  // older step with the same digest (if any) is shadowed
+  m_index [digest] = m_lastStep;
+  return m_lastStep;
+}
+
+void
+DiffHistory::pop ()
+{
+  BOOST_ASSERT (m_size > 0);
+
+  uint64_t step = m_lastStep - m_size + 1;
+
+  DigestIndex::iterator item = m_index.find (m_steps [m_first]);
+  if (item != m_index.end () && item->second == step)
+    m_index.erase (item);
+
+  m_first = (m_first + 1) % m_steps.size ();
+  m_size --;
+}
+
+uint64_t
+DiffHistory::find (const DigestValue &digest) const
+{
+  DigestIndex::const_iterator item = m_index.find (digest);
+  if (item == m_index.end ())
+    return 0;
+
+  return item->second;
+}
+
+size_t
+DiffHistory::getMemoryUsage () const
+{
+  // a step in the ring buffer and an entry of the index (node with the digest, step and a bucket)
+  return m_size * (2 * sizeof (DigestValue) + sizeof (uint64_t) + 2 * sizeof (void*));
+}
+
+void
+DiffHistory::grow ()
+{
+  std::vector<DigestValue> steps (m_steps.empty () ? INITIAL_CAPACITY : 2 * m_steps.size ());
+  for (size_t i = 0; i < m_size; i++)
+    steps [i] = m_steps [(m_first + i) % m_steps.size ()];
+
+  m_steps.swap (steps);
+  m_first = 0;
+}
+
+} // Sync
@@ -0,0 +1,112 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Zhenkai Zhu <zhenkai@cs.ucla.edu>
+ *         Chaoyi Bian <bcy@pku.edu.cn>
+ *	   Alexander Afanasyev <alexander.afanasyev@ucla.edu>
+ */
+
+#ifndef SYNC_DIFF_HISTORY_H
+#define SYNC_DIFF_HISTORY_H
+
+#include "sync-digest.h"
+
+#include <boost/unordered_map.hpp>
+#include <boost/cstdint.hpp>
+#include <vector>
+
+namespace Sync {
+
+/**
+ * \ingroup sync
+ * @brief History of root digests, kept in a ring buffer
+ *
+ * Every step of the history holds digest of the full state after the step.
+ * Steps are numbered sequentially (starting from 1) and are found by digest
+ * using the hash index.  Changes themselves are not kept here: the latest
+ * change of every name is recorded with its step number in ChangeIndex, which
+ * is used to build replies for digests found in the history
+ */
+class DiffHistory
+{
+public:
+  DiffHistory ();
+
+  /**
+   * @brief Append the digest as the newest step of the history
+   * @param digest digest of the full state after the step
+   * @returns step number assigned to the digest
+   *
+   * If an older step has the same digest, it will no longer be found by digest
+   */
+  uint64_t
+  push (const DigestValue &digest);
+
+  /**
+   * @brief Remove the oldest step from the history
+   */
+  void
+  pop ();
+
+  /**
+   * @brief Find step, after which the full state had the digest
+   * @returns step number or 0 if digest is not in the history
+   */
+  uint64_t
+  find (const DigestValue &digest) const;
+
+  /**
+   * @brief Number of steps in the history
+   */
+  size_t
+  size () const { return m_size; }
+
+  /**
+   * @brief Get step number of the newest step (0 if nothing has been pushed yet)
+   */
+  uint64_t
+  getLastStep () const { return m_lastStep; }
+
+  /**
+   * @brief Get step number of the oldest step (getLastStep () + 1 if the history is empty)
+   */
+  uint64_t
+  getFirstStep () const { return m_lastStep - m_size + 1; }
+
+  /**
+   * @brief Get approximate amount of memory used by the steps and the digest index
+   */
+  size_t
+  getMemoryUsage () const;
+
+private:
+  void
+  grow ();
+
+private:
+  std::vector<DigestValue> m_steps; ///< @brief ring buffer of digests
+  size_t m_first; ///< @brief position of the oldest step in the buffer
+  size_t m_size;
+  uint64_t m_lastStep;
+
+  typedef boost::unordered_map<DigestValue, uint64_t> DigestIndex;
+  DigestIndex m_index;
+};
+
+} // Sync
+
+#endif // SYNC_DIFF_HISTORY_H
@@ -21,7 +21,6 @@
  */
 
 #include "sync-diff-state.h"
-#include "sync-diff-leaf.h"
 
 #include <boost/make_shared.hpp>
 #include <boost/foreach.hpp>
@@ -31,7 +30,10 @@ using namespace boost;
 
 namespace Sync {
 
-DiffState::DiffState ()
+DiffState::DiffState (const ObjectPoolPtr &pool)
+  : m_pool (pool)
+  , m_allocator (pool)
+  , m_leaves (pool)
 {
 }
 
@@ -39,29 +41,11 @@ DiffState::~DiffState ()
 {
 }
 
-DiffStatePtr
-DiffState::diff () const
-{
-  DiffStatePtr ret = make_shared<DiffState> ();
-  
-  DiffStatePtr state = m_next;
-  while (state != 0)
-    {
-      *ret += *state;
-      state = state->m_next;
-    }
-
-  return ret;
-}
-
 DiffState &
 DiffState::operator += (const DiffState &state)
 {
-  BOOST_FOREACH (LeafConstPtr _leaf, state.getLeaves ())
+  BOOST_FOREACH (const DiffLeafPtr &leaf, state.getLeaves ())
     {
-      DiffLeafConstPtr leaf = dynamic_pointer_cast<const DiffLeaf> (_leaf);
-      BOOST_ASSERT (leaf != 0);
-
       if (leaf->getOperation () == UPDATE)
         update (leaf->getInfo (), leaf->getSeq ());
       else if (leaf->getOperation () == REMOVE)
@@ -81,7 +65,7 @@ DiffState::update (NameInfoConstPtr info, const SeqNo &seq)
 {
   m_leaves.erase (info);
 
-  DiffLeafPtr leaf = make_shared<DiffLeaf> (info, cref (seq));
+  DiffLeafPtr leaf = allocate_shared<DiffLeaf> (m_allocator, info, cref (seq));
   m_leaves.insert (leaf);
 
   return make_tuple (true, false, SeqNo ());
@@ -92,7 +76,7 @@ DiffState::remove (NameInfoConstPtr info)
 {
   m_leaves.erase (info);
 
-  DiffLeafPtr leaf = make_shared<DiffLeaf> (info);
+  DiffLeafPtr leaf = allocate_shared<DiffLeaf> (m_allocator, info);
   m_leaves.insert (leaf);
 
   return true;
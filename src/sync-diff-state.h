@@ -24,6 +24,7 @@
 #define SYNC_DIFF_STATE_H
 
 #include "sync-state.h"
+#include "sync-diff-leaf.h"
 #include <iostream>
 
 namespace Sync {
@@ -41,39 +42,23 @@ class DiffState : public State
 public:
   /**
    * @see Default constructor
+   * @param pool pool to allocate leaves from (global heap if not set)
    */
-  DiffState ();
+  DiffState (const ObjectPoolPtr &pool = ObjectPoolPtr ());
   virtual ~DiffState ();
 
-  /**
-   * @brief Set successor for the diff state
-   * @param next successor state
-   */
-  void
-  setNext (DiffStatePtr next)
-  {
-    m_next = next;
-  }
-
   /**
    * @brief Set digest for the diff state (obtained from a corresponding full state)
-   * @param digest A read only smart pointer to a digest object (that should be unmodified anywhere else)
+   * @param digest Digest value of the corresponding full state
    */
   void
-  setDigest (DigestConstPtr digest) { m_digest = digest; }
+  setDigest (const DigestValue &digest) { m_digest = digest; }
 
   /**
    * @brief Get digest for the diff state
    */
-  DigestConstPtr
+  const DigestValue &
   getDigest () const { return m_digest; }
-  
-  /**
-   * @brief Accumulate differences from `this' state to the most current state
-   * @returns Accumulated differences from `this' state to the most current state
-   */
-  DiffStatePtr
-  diff () const;
 
   /**
    * @brief Combine differences from `this' and `state'
@@ -84,7 +69,13 @@ public:
    */
   DiffState&
   operator += (const DiffState &state);
-  
+
+  /**
+   * @brief Get state leaves
+   */
+  const LeafContainer<DiffLeaf> &
+  getLeaves () const { return m_leaves; }
+
   // from State
   virtual boost::tuple<bool/*inserted*/, bool/*updated*/, SeqNo/*oldSeqNo*/>
   update (NameInfoConstPtr info, const SeqNo &seq);
@@ -93,10 +84,30 @@ public:
   remove (NameInfoConstPtr info);
   
 private:
-  DiffStatePtr m_next;
-  DigestConstPtr m_digest;
+  ObjectPoolPtr m_pool;
+  PoolAllocator<DiffLeaf> m_allocator;
+  LeafContainer<DiffLeaf> m_leaves;
+  DigestValue m_digest;
 };
 
+/**
+ * @brief Formats a protobuf SyncStateMsg msg
+ * @param oss output SyncStateMsg msg
+ * @param state differential state
+ * @returns output SyncStateMsg msg
+ */
+SyncStateMsg &
+operator << (SyncStateMsg &ossm, const DiffState &state);
+
+/**
+ * @brief Encode differential state for a Sync Data packet
+ * @param state differential state
+ * @param format wire format
+ * @param wireData output buffer (replaced)
+ */
+void
+encodeState (const DiffState &state, WireFormat format, std::string &wireData);
+
 } // Sync
 
 #endif // SYNC_DIFF_STATE_H
@@ -0,0 +1,598 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Zhenkai Zhu <zhenkai@cs.ucla.edu>
+ *         Chaoyi Bian <bcy@pku.edu.cn>
+ *	   Alexander Afanasyev <alexander.afanasyev@ucla.edu>
+ */
+
+#include "sync-digest-engine.h"
+#include <string.h>
+#include <algorithm>
+
+#if (defined (__x86_64__) || defined (__i386__)) && defined (__GNUC__)
+#define SYNC_HAVE_X86_INTRINSICS 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+namespace Sync {
+
+////////////////////////////////////////////////////////////////////////////////
+// OpensslSha256Engine
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Get hash function descriptor
+ *
+ * With OpenSSL 3.0+ the descriptor is fetched explicitly only once, otherwise
+ * every EVP_DigestInit_ex call would do an implicit (and expensive) fetch
+ */
+static const EVP_MD *
+getHashFunction ()
+{
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+  static const EVP_MD *md = EVP_MD_fetch (0, "SHA256", 0);
+#else
+  static const EVP_MD *md = EVP_sha256 ();
+#endif
+  return md;
+}
+
+OpensslSha256Engine::OpensslSha256Engine ()
+  : m_context (EVP_MD_CTX_create ())
+{
+}
+
+OpensslSha256Engine::~OpensslSha256Engine ()
+{
+  EVP_MD_CTX_destroy (m_context);
+}
+
+bool
+OpensslSha256Engine::init ()
+{
+  return EVP_DigestInit_ex (m_context, getHashFunction (), 0);
+}
+
+bool
+OpensslSha256Engine::update (const void *buffer, size_t size)
+{
+  return EVP_DigestUpdate (m_context, buffer, size);
+}
+
+bool
+OpensslSha256Engine::finalize (uint8_t *digest, uint32_t &size)
+{
+  uint8_t buffer[EVP_MAX_MD_SIZE];
+  unsigned int length = 0;
+
+  if (!EVP_DigestFinal_ex (m_context, buffer, &length) || length > MAX_DIGEST_SIZE)
+    return false;
+
+  memcpy (digest, buffer, length);
+  size = length;
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Sha256Engine
+////////////////////////////////////////////////////////////////////////////////
+
+static const uint32_t SHA256_K[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static const uint32_t SHA256_INIT[8] = {
+  0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+static inline uint32_t
+rotr32 (uint32_t x, int n)
+{
+  return (x >> n) | (x << (32 - n));
+}
+
+static inline uint32_t
+readBigEndian32 (const uint8_t *p)
+{
+  return (uint32_t (p[0]) << 24) | (uint32_t (p[1]) << 16) | (uint32_t (p[2]) << 8) | uint32_t (p[3]);
+}
+
+static void
+sha256CompressPortable (uint32_t *state, const uint8_t *blocks, size_t count)
+{
+  for (; count > 0; count--, blocks += 64)
+    {
+      uint32_t w[64];
+      for (int i = 0; i < 16; i++)
+        w[i] = readBigEndian32 (blocks + 4 * i);
+      for (int i = 16; i < 64; i++)
+        {
+          uint32_t s0 = rotr32 (w[i-15], 7) ^ rotr32 (w[i-15], 18) ^ (w[i-15] >> 3);
+          uint32_t s1 = rotr32 (w[i-2], 17) ^ rotr32 (w[i-2], 19) ^ (w[i-2] >> 10);
+          w[i] = w[i-16] + s0 + w[i-7] + s1;
+        }
+
+      uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+      uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+      for (int i = 0; i < 64; i++)
+        {
+          uint32_t S1 = rotr32 (e, 6) ^ rotr32 (e, 11) ^ rotr32 (e, 25);
+          uint32_t ch = (e & f) ^ (~e & g);
+          uint32_t t1 = h + S1 + ch + SHA256_K[i] + w[i];
+          uint32_t S0 = rotr32 (a, 2) ^ rotr32 (a, 13) ^ rotr32 (a, 22);
+          uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+          uint32_t t2 = S0 + maj;
+
+          h = g; g = f; f = e; e = d + t1;
+          d = c; c = b; b = a; a = t1 + t2;
+        }
+
+      state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+      state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+    }
+}
+
+#ifdef SYNC_HAVE_X86_INTRINSICS
+
+__attribute__ ((target ("sha,sse4.1,ssse3")))
+static void
+sha256CompressShaNi (uint32_t *state, const uint8_t *blocks, size_t count)
+{
+  const __m128i byteSwap = _mm_set_epi64x (0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+  // state is kept as ABEF / CDGH, as expected by sha256rnds2
+  __m128i tmp = _mm_shuffle_epi32 (_mm_loadu_si128 (reinterpret_cast<const __m128i*> (state)), 0xB1);
+  __m128i state1 = _mm_shuffle_epi32 (_mm_loadu_si128 (reinterpret_cast<const __m128i*> (state + 4)), 0x1B);
+  __m128i state0 = _mm_alignr_epi8 (tmp, state1, 8);
+  state1 = _mm_blend_epi16 (state1, tmp, 0xF0);
+
+  for (; count > 0; count--, blocks += 64)
+    {
+      __m128i savedState0 = state0;
+      __m128i savedState1 = state1;
+      __m128i msg[4];
+
+      for (int group = 0; group < 16; group++)
+        {
+          if (group < 4)
+            {
+              msg[group] = _mm_shuffle_epi8 (_mm_loadu_si128 (reinterpret_cast<const __m128i*> (blocks + 16 * group)),
+                                             byteSwap);
+            }
+          else
+            {
+              // W[t] = s1(W[t-2]) + W[t-7] + s0(W[t-15]) + W[t-16]
+              __m128i w = _mm_sha256msg1_epu32 (msg[group & 3], msg[(group + 1) & 3]);
+              w = _mm_add_epi32 (w, _mm_alignr_epi8 (msg[(group + 3) & 3], msg[(group + 2) & 3], 4));
+              msg[group & 3] = _mm_sha256msg2_epu32 (w, msg[(group + 3) & 3]);
+            }
+
+          __m128i rounds = _mm_add_epi32 (msg[group & 3],
+                                          _mm_loadu_si128 (reinterpret_cast<const __m128i*> (SHA256_K + 4 * group)));
+          state1 = _mm_sha256rnds2_epu32 (state1, state0, rounds);
+          rounds = _mm_shuffle_epi32 (rounds, 0x0E);
+          state0 = _mm_sha256rnds2_epu32 (state0, state1, rounds);
+        }
+
+      state0 = _mm_add_epi32 (state0, savedState0);
+      state1 = _mm_add_epi32 (state1, savedState1);
+    }
+
+  tmp = _mm_shuffle_epi32 (state0, 0x1B);
+  state1 = _mm_shuffle_epi32 (state1, 0xB1);
+  state0 = _mm_blend_epi16 (tmp, state1, 0xF0);
+  state1 = _mm_alignr_epi8 (state1, tmp, 8);
+
+  _mm_storeu_si128 (reinterpret_cast<__m128i*> (state), state0);
+  _mm_storeu_si128 (reinterpret_cast<__m128i*> (state + 4), state1);
+}
+
+static bool
+detectShaNi ()
+{
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid (1, &eax, &ebx, &ecx, &edx) ||
+      !(ecx & bit_SSSE3) || !(ecx & bit_SSE4_1))
+    return false;
+
+  if (__get_cpuid_max (0, 0) < 7)
+    return false;
+
+  __cpuid_count (7, 0, eax, ebx, ecx, edx);
+  return (ebx & (1 << 29)) != 0; // SHA extensions
+}
+
+#endif // SYNC_HAVE_X86_INTRINSICS
+
+bool
+Sha256Engine::isAccelerationSupported ()
+{
+#ifdef SYNC_HAVE_X86_INTRINSICS
+  static bool supported = detectShaNi ();
+  return supported;
+#else
+  return false;
+#endif
+}
+
+Sha256Engine::Sha256Engine (bool useAcceleration/* = true*/)
+  : m_compress (&sha256CompressPortable)
+{
+#ifdef SYNC_HAVE_X86_INTRINSICS
+  if (useAcceleration && isAccelerationSupported ())
+    m_compress = &sha256CompressShaNi;
+#endif
+
+  init ();
+}
+
+bool
+Sha256Engine::init ()
+{
+  memcpy (m_state, SHA256_INIT, sizeof (m_state));
+  m_blockLength = 0;
+  m_length = 0;
+  return true;
+}
+
+bool
+Sha256Engine::update (const void *buffer, size_t size)
+{
+  const uint8_t *data = reinterpret_cast<const uint8_t*> (buffer);
+  m_length += size;
+
+  if (m_blockLength > 0)
+    {
+      size_t chunk = std::min (size, sizeof (m_block) - m_blockLength);
+      memcpy (m_block + m_blockLength, data, chunk);
+      m_blockLength += chunk;
+      data += chunk;
+      size -= chunk;
+
+      if (m_blockLength < sizeof (m_block))
+        return true;
+
+      m_compress (m_state, m_block, 1);
+      m_blockLength = 0;
+    }
+
+  // full blocks are compressed directly from the input
+  size_t blocks = size / sizeof (m_block);
+  if (blocks > 0)
+    {
+      m_compress (m_state, data, blocks);
+      data += blocks * sizeof (m_block);
+      size -= blocks * sizeof (m_block);
+    }
+
+  memcpy (m_block, data, size);
+  m_blockLength = size;
+  return true;
+}
+
+bool
+Sha256Engine::finalize (uint8_t *digest, uint32_t &size)
+{
+  uint64_t bitLength = m_length * 8;
+
+  m_block[m_blockLength++] = 0x80;
+  if (m_blockLength > sizeof (m_block) - 8)
+    {
+      memset (m_block + m_blockLength, 0, sizeof (m_block) - m_blockLength);
+      m_compress (m_state, m_block, 1);
+      m_blockLength = 0;
+    }
+  memset (m_block + m_blockLength, 0, sizeof (m_block) - 8 - m_blockLength);
+  for (int i = 0; i < 8; i++)
+    m_block[sizeof (m_block) - 1 - i] = static_cast<uint8_t> (bitLength >> (8 * i));
+  m_compress (m_state, m_block, 1);
+
+  for (int i = 0; i < 8; i++)
+    {
+      digest[4*i]   = static_cast<uint8_t> (m_state[i] >> 24);
+      digest[4*i+1] = static_cast<uint8_t> (m_state[i] >> 16);
+      digest[4*i+2] = static_cast<uint8_t> (m_state[i] >> 8);
+      digest[4*i+3] = static_cast<uint8_t> (m_state[i]);
+    }
+  size = 32;
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Sha256MultiBufferEngine
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef SYNC_HAVE_X86_INTRINSICS
+
+#define ROTR_8x32(x, n) _mm256_or_si256 (_mm256_srli_epi32 (x, n), _mm256_slli_epi32 (x, 32 - (n)))
+
+// one SHA-256 message block of every lane, transposed: word i of lane l is lane l of w[i]
+__attribute__ ((target ("avx2")))
+static void
+sha256CompressAvx2x8 (__m256i *state, __m256i *w)
+{
+  __m256i a = state[0], b = state[1], c = state[2], d = state[3];
+  __m256i e = state[4], f = state[5], g = state[6], h = state[7];
+
+  for (int t = 0; t < 64; t++)
+    {
+      if (t >= 16)
+        {
+          __m256i w15 = w[(t - 15) & 15];
+          __m256i w2  = w[(t - 2) & 15];
+          __m256i s0 = _mm256_xor_si256 (_mm256_xor_si256 (ROTR_8x32 (w15, 7), ROTR_8x32 (w15, 18)),
+                                         _mm256_srli_epi32 (w15, 3));
+          __m256i s1 = _mm256_xor_si256 (_mm256_xor_si256 (ROTR_8x32 (w2, 17), ROTR_8x32 (w2, 19)),
+                                         _mm256_srli_epi32 (w2, 10));
+          w[t & 15] = _mm256_add_epi32 (_mm256_add_epi32 (w[t & 15], s0),
+                                        _mm256_add_epi32 (w[(t - 7) & 15], s1));
+        }
+
+      __m256i S1 = _mm256_xor_si256 (_mm256_xor_si256 (ROTR_8x32 (e, 6), ROTR_8x32 (e, 11)), ROTR_8x32 (e, 25));
+      __m256i ch = _mm256_xor_si256 (_mm256_and_si256 (e, f), _mm256_andnot_si256 (e, g));
+      __m256i t1 = _mm256_add_epi32 (_mm256_add_epi32 (_mm256_add_epi32 (h, S1), ch),
+                                     _mm256_add_epi32 (_mm256_set1_epi32 (SHA256_K[t]), w[t & 15]));
+      __m256i S0 = _mm256_xor_si256 (_mm256_xor_si256 (ROTR_8x32 (a, 2), ROTR_8x32 (a, 13)), ROTR_8x32 (a, 22));
+      __m256i maj = _mm256_xor_si256 (_mm256_and_si256 (a, _mm256_xor_si256 (b, c)), _mm256_and_si256 (b, c));
+      __m256i t2 = _mm256_add_epi32 (S0, maj);
+
+      h = g; g = f; f = e; e = _mm256_add_epi32 (d, t1);
+      d = c; c = b; b = a; a = _mm256_add_epi32 (t1, t2);
+    }
+
+  state[0] = _mm256_add_epi32 (state[0], a); state[1] = _mm256_add_epi32 (state[1], b);
+  state[2] = _mm256_add_epi32 (state[2], c); state[3] = _mm256_add_epi32 (state[3], d);
+  state[4] = _mm256_add_epi32 (state[4], e); state[5] = _mm256_add_epi32 (state[5], f);
+  state[6] = _mm256_add_epi32 (state[6], g); state[7] = _mm256_add_epi32 (state[7], h);
+}
+
+#undef ROTR_8x32
+
+__attribute__ ((target ("avx2")))
+static void
+sha256HashAvx2x8 (const uint8_t *const *buffers, size_t size, uint8_t *digests)
+{
+  const size_t LANES = Sha256MultiBufferEngine::LANES;
+
+  // message padding is the same for all lanes, only the data differs
+  size_t fullBlocks = size / 64;
+  size_t tailSize = size % 64;
+  size_t tailBlocks = (tailSize + 1 + 8 <= 64) ? 1 : 2;
+
+  uint8_t tail[LANES][128];
+  for (size_t lane = 0; lane < LANES; lane++)
+    {
+      memcpy (tail[lane], buffers[lane] + fullBlocks * 64, tailSize);
+      tail[lane][tailSize] = 0x80;
+      memset (tail[lane] + tailSize + 1, 0, tailBlocks * 64 - tailSize - 1);
+      for (int i = 0; i < 8; i++)
+        tail[lane][tailBlocks * 64 - 1 - i] = static_cast<uint8_t> ((uint64_t (size) * 8) >> (8 * i));
+    }
+
+  __m256i state[8];
+  for (int i = 0; i < 8; i++)
+    state[i] = _mm256_set1_epi32 (SHA256_INIT[i]);
+
+  for (size_t block = 0; block < fullBlocks + tailBlocks; block++)
+    {
+      const uint8_t *data[LANES];
+      for (size_t lane = 0; lane < LANES; lane++)
+        data[lane] = (block < fullBlocks) ?
+          buffers[lane] + block * 64 :
+          tail[lane] + (block - fullBlocks) * 64;
+
+      __m256i w[16];
+      for (int i = 0; i < 16; i++)
+        w[i] = _mm256_set_epi32 (readBigEndian32 (data[7] + 4 * i), readBigEndian32 (data[6] + 4 * i),
+                                 readBigEndian32 (data[5] + 4 * i), readBigEndian32 (data[4] + 4 * i),
+                                 readBigEndian32 (data[3] + 4 * i), readBigEndian32 (data[2] + 4 * i),
+                                 readBigEndian32 (data[1] + 4 * i), readBigEndian32 (data[0] + 4 * i));
+
+      sha256CompressAvx2x8 (state, w);
+    }
+
+  uint32_t words[8][LANES];
+  for (int i = 0; i < 8; i++)
+    _mm256_storeu_si256 (reinterpret_cast<__m256i*> (words[i]), state[i]);
+
+  for (size_t lane = 0; lane < LANES; lane++)
+    for (int i = 0; i < 8; i++)
+      {
+        uint8_t *digest = digests + lane * 32 + 4 * i;
+        digest[0] = static_cast<uint8_t> (words[i][lane] >> 24);
+        digest[1] = static_cast<uint8_t> (words[i][lane] >> 16);
+        digest[2] = static_cast<uint8_t> (words[i][lane] >> 8);
+        digest[3] = static_cast<uint8_t> (words[i][lane]);
+      }
+}
+
+static bool
+detectAvx2 ()
+{
+  __builtin_cpu_init ();
+  return __builtin_cpu_supports ("avx2");
+}
+
+#endif // SYNC_HAVE_X86_INTRINSICS
+
+bool
+Sha256MultiBufferEngine::isSupported ()
+{
+#ifdef SYNC_HAVE_X86_INTRINSICS
+  static bool supported = detectAvx2 ();
+  return supported;
+#else
+  return false;
+#endif
+}
+
+void
+Sha256MultiBufferEngine::hash (const uint8_t *const *buffers, size_t size, uint8_t *digests)
+{
+#ifdef SYNC_HAVE_X86_INTRINSICS
+  if (isSupported ())
+    {
+      sha256HashAvx2x8 (buffers, size, digests);
+      return;
+    }
+#endif
+
+  Sha256Engine engine;
+  for (size_t lane = 0; lane < LANES; lane++)
+    {
+      uint32_t digestSize;
+      engine.init ();
+      engine.update (buffers[lane], size);
+      engine.finalize (digests + lane * 32, digestSize);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// FastHashEngine
+////////////////////////////////////////////////////////////////////////////////
+
+// multiplication constants from xxHash64
+static const uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+static const uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+
+static inline uint64_t
+rotl64 (uint64_t x, int n)
+{
+  return (x << n) | (x >> (64 - n));
+}
+
+// words are read and written in little-endian order, so digests do not depend on the host
+static inline uint64_t
+load64le (const uint8_t *p)
+{
+  uint64_t x = 0;
+  for (int i = 7; i >= 0; i--)
+    x = (x << 8) | p[i];
+  return x;
+}
+
+static inline void
+store64le (uint8_t *p, uint64_t x)
+{
+  for (int i = 0; i < 8; i++, x >>= 8)
+    p[i] = static_cast<uint8_t> (x);
+}
+
+static inline uint64_t
+avalanche64 (uint64_t x)
+{
+  x ^= x >> 33;
+  x *= PRIME64_2;
+  x ^= x >> 29;
+  x *= PRIME64_3;
+  x ^= x >> 32;
+  return x;
+}
+
+FastHashEngine::FastHashEngine ()
+{
+  init ();
+}
+
+bool
+FastHashEngine::init ()
+{
+  m_lanes[0] = PRIME64_1 + PRIME64_2;
+  m_lanes[1] = PRIME64_2;
+  m_lanes[2] = 0;
+  m_lanes[3] = 0 - PRIME64_1;
+  m_stripeLength = 0;
+  m_length = 0;
+  return true;
+}
+
+void
+FastHashEngine::processStripe (const uint8_t *stripe)
+{
+  for (int i = 0; i < 4; i++)
+    {
+      uint64_t word = load64le (stripe + 8 * i);
+      m_lanes[i] = rotl64 (m_lanes[i] + word * PRIME64_2, 31) * PRIME64_1;
+    }
+}
+
+bool
+FastHashEngine::update (const void *buffer, size_t size)
+{
+  const uint8_t *data = reinterpret_cast<const uint8_t*> (buffer);
+  m_length += size;
+
+  if (m_stripeLength > 0)
+    {
+      size_t chunk = std::min (size, sizeof (m_stripe) - m_stripeLength);
+      memcpy (m_stripe + m_stripeLength, data, chunk);
+      m_stripeLength += chunk;
+      data += chunk;
+      size -= chunk;
+
+      if (m_stripeLength < sizeof (m_stripe))
+        return true;
+
+      processStripe (m_stripe);
+      m_stripeLength = 0;
+    }
+
+  for (; size >= sizeof (m_stripe); data += sizeof (m_stripe), size -= sizeof (m_stripe))
+    processStripe (data);
+
+  memcpy (m_stripe, data, size);
+  m_stripeLength = size;
+  return true;
+}
+
+bool
+FastHashEngine::finalize (uint8_t *digest, uint32_t &size)
+{
+  // zero-padded tail; total length is mixed in below, so padding is unambiguous
+  if (m_stripeLength > 0)
+    {
+      memset (m_stripe + m_stripeLength, 0, sizeof (m_stripe) - m_stripeLength);
+      processStripe (m_stripe);
+    }
+
+  uint64_t mix = m_length * PRIME64_4;
+  for (int i = 0; i < 4; i++)
+    mix = rotl64 (mix ^ avalanche64 (m_lanes[i]), 27) * PRIME64_1 + PRIME64_4;
+
+  // every output word depends on all lanes
+  for (int i = 0; i < 4; i++)
+    {
+      uint64_t word = avalanche64 (m_lanes[i] ^ rotl64 (mix, 16 * i + 1) ^ (PRIME64_3 * (i + 1)));
+      store64le (digest + 8 * i, word);
+    }
+  size = 32;
+  return true;
+}
+
+} // Sync
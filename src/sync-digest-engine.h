@@ -0,0 +1,188 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Zhenkai Zhu <zhenkai@cs.ucla.edu>
+ *         Chaoyi Bian <bcy@pku.edu.cn>
+ *	   Alexander Afanasyev <alexander.afanasyev@ucla.edu>
+ */
+
+#ifndef SYNC_DIGEST_ENGINE_H
+#define SYNC_DIGEST_ENGINE_H
+
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <openssl/evp.h>
+#include <cstddef>
+
+namespace Sync {
+
+// All hash engines provide the same (non-virtual) interface:
+//  - init ()                   start new hash calculation
+//  - update (buffer, size)     add bytes to the hash
+//  - finalize (digest, size)   write hash value (at most MAX_DIGEST_SIZE bytes)
+//
+// All calls return false on error.  Engine objects can be reused for several
+// calculations, as long as init () is called before each of them.
+
+/**
+ * @brief Maximum size of the hash value produced by any of the engines
+ */
+const uint32_t MAX_DIGEST_SIZE = 32;
+
+/**
+ * @ingroup sync
+ * @brief SHA-256 engine implemented by libcrypto (the default one)
+ */
+class OpensslSha256Engine : boost::noncopyable
+{
+public:
+  OpensslSha256Engine ();
+  ~OpensslSha256Engine ();
+
+  bool
+  init ();
+
+  bool
+  update (const void *buffer, size_t size);
+
+  bool
+  finalize (uint8_t *digest, uint32_t &size);
+
+private:
+  EVP_MD_CTX *m_context;
+};
+
+/**
+ * @ingroup sync
+ * @brief Built-in SHA-256 engine that uses SHA-NI instructions when the CPU has them
+ *
+ * Produces exactly the same values as OpensslSha256Engine, so peers using
+ * different SHA-256 engines are fully compatible.  If SHA-NI instructions
+ * are not available (or not requested), portable implementation is used.
+ */
+class Sha256Engine : boost::noncopyable
+{
+public:
+  /**
+   * @param useAcceleration if false, SHA-NI instructions will not be used
+   * even when CPU supports them
+   */
+  Sha256Engine (bool useAcceleration = true);
+
+  bool
+  init ();
+
+  bool
+  update (const void *buffer, size_t size);
+
+  bool
+  finalize (uint8_t *digest, uint32_t &size);
+
+  /**
+   * @brief Check if CPU supports SHA-NI instructions (and they were compiled in)
+   */
+  static bool
+  isAccelerationSupported ();
+
+private:
+  typedef void (*CompressFunction) (uint32_t *state, const uint8_t *blocks, size_t count);
+
+  CompressFunction m_compress;
+  uint32_t m_state[8];
+  uint8_t m_block[64];
+  size_t m_blockLength;
+  uint64_t m_length;
+};
+
+/**
+ * @ingroup sync
+ * @brief Multi-buffer SHA-256: calculates hashes of LANES independent buffers at once
+ *
+ * All buffers should have the same size.  AVX2 instructions are used when CPU
+ * supports them, otherwise buffers are hashed one by one with Sha256Engine
+ */
+class Sha256MultiBufferEngine
+{
+public:
+  static const size_t LANES = 8;
+
+  /**
+   * @brief Check if CPU supports vectorized (AVX2) implementation
+   */
+  static bool
+  isSupported ();
+
+  /**
+   * @brief Calculate SHA-256 of LANES buffers
+   * @param buffers array of LANES pointers to the buffers
+   * @param size size of each buffer
+   * @param digests output buffer for LANES*32 bytes of hash values
+   */
+  static void
+  hash (const uint8_t *const *buffers, size_t size, uint8_t *digests);
+};
+
+/**
+ * @ingroup sync
+ * @brief Fast non-cryptographic 256-bit hash engine
+ *
+ * Intended ONLY for closed simulation studies, where resistance against
+ * deliberately constructed collisions is irrelevant.  Values are not
+ * compatible with SHA-256 engines, so all peers should use this engine.
+ */
+class FastHashEngine : boost::noncopyable
+{
+public:
+  FastHashEngine ();
+
+  bool
+  init ();
+
+  bool
+  update (const void *buffer, size_t size);
+
+  bool
+  finalize (uint8_t *digest, uint32_t &size);
+
+private:
+  void
+  processStripe (const uint8_t *stripe);
+
+private:
+  uint64_t m_lanes[4];
+  uint8_t m_stripe[32];
+  size_t m_stripeLength;
+  uint64_t m_length;
+};
+
+/**
+ * @ingroup sync
+ * @brief Engine used by Digest class, selected at compile time
+ *
+ * Use ./waf configure --digest=sha256|sha-ni|fast to select the engine
+ */
+#if defined (DIGEST_ENGINE_FAST)
+class DigestEngine : public FastHashEngine { };
+#elif defined (DIGEST_ENGINE_SHA_NI)
+class DigestEngine : public Sha256Engine { };
+#else
+class DigestEngine : public OpensslSha256Engine { };
+#endif
+
+} // Sync
+
+#endif // SYNC_DIGEST_ENGINE_H
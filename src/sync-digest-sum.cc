@@ -0,0 +1,88 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Zhenkai Zhu <zhenkai@cs.ucla.edu>
+ *         Chaoyi Bian <bcy@pku.edu.cn>
+ *	   Alexander Afanasyev <alexander.afanasyev@ucla.edu>
+ */
+
+#include "sync-digest-sum.h"
+#include <string.h>
+#include <algorithm>
+
+#include <boost/throw_exception.hpp>
+typedef boost::error_info<struct tag_errmsg, std::string> errmsg_info_str; 
+
+namespace Sync {
+
+DigestSum::DigestSum ()
+{
+  clear ();
+}
+
+void
+DigestSum::clear ()
+{
+  memset (m_sum, 0, sizeof (m_sum));
+  m_length = 0;
+}
+
+DigestSum &
+DigestSum::operator += (const DigestValue &digest)
+{
+  if (digest.empty ())
+    BOOST_THROW_EXCEPTION (Error::DigestCalculationError ()
+                           << errmsg_info_str ("Digest has not been yet finalized"));
+
+  m_length = std::max (m_length, digest.size ());
+
+  uint32_t carry = 0;
+  for (uint32_t i = 0; i < m_length; i++)
+    {
+      uint32_t value = m_sum[i] + carry + digest.data ()[i];
+      m_sum[i] = static_cast<uint8_t> (value);
+      carry = value >> 8;
+    }
+  return *this;
+}
+
+DigestSum &
+DigestSum::operator -= (const DigestValue &digest)
+{
+  if (digest.empty ())
+    BOOST_THROW_EXCEPTION (Error::DigestCalculationError ()
+                           << errmsg_info_str ("Digest has not been yet finalized"));
+
+  m_length = std::max (m_length, digest.size ());
+
+  int32_t borrow = 0;
+  for (uint32_t i = 0; i < m_length; i++)
+    {
+      int32_t value = static_cast<int32_t> (m_sum[i]) - borrow - digest.data ()[i];
+      borrow = value < 0 ? 1 : 0;
+      m_sum[i] = static_cast<uint8_t> (value + (borrow << 8));
+    }
+  return *this;
+}
+
+Digest &
+operator << (Digest &digest, const DigestSum &sum)
+{
+  return digest << DigestValue (sum.m_sum, sum.m_length);
+}
+
+} // Sync
@@ -0,0 +1,82 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Zhenkai Zhu <zhenkai@cs.ucla.edu>
+ *         Chaoyi Bian <bcy@pku.edu.cn>
+ *	   Alexander Afanasyev <alexander.afanasyev@ucla.edu>
+ */
+
+#ifndef SYNC_DIGEST_SUM_H
+#define SYNC_DIGEST_SUM_H
+
+#include "sync-digest.h"
+
+namespace Sync {
+
+/**
+ * @ingroup sync
+ * @brief Commutative accumulator of finalized digests
+ *
+ * Digest values are interpreted as little-endian integers and added modulo
+ * 2^(8*length).  Since the combination does not depend on the order,
+ * a single digest can be added or taken out of the sum in O(1), without
+ * touching the rest of the digests.
+ */
+class DigestSum
+{
+public:
+  /**
+   * @brief Default constructor.  Creates an empty (zero) sum
+   */
+  DigestSum ();
+
+  /**
+   * @brief Add finalized digest to the sum
+   */
+  DigestSum &
+  operator += (const DigestValue &digest);
+
+  /**
+   * @brief Remove finalized digest (that was previously added) from the sum
+   */
+  DigestSum &
+  operator -= (const DigestValue &digest);
+
+  /**
+   * @brief Reset sum to zero
+   */
+  void
+  clear ();
+
+private:
+  friend Digest &
+  operator << (Digest &digest, const DigestSum &sum);
+
+private:
+  uint8_t m_sum[DigestValue::MAX_SIZE];
+  uint32_t m_length;
+};
+
+/**
+ * @brief Add value of the sum to digest calculation
+ */
+Digest &
+operator << (Digest &digest, const DigestSum &sum);
+
+} // Sync
+
+#endif // SYNC_DIGEST_SUM_H
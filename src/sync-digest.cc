@@ -21,194 +21,235 @@
  */
 
 #include "sync-digest.h"
+#include "sync-digest-engine.h"
+#include "sync-hex.h"
 #include <string.h>
 
 #include <boost/assert.hpp>
 #include <boost/throw_exception.hpp>
+#include <boost/thread/tss.hpp>
+#include <vector>
 typedef boost::error_info<struct tag_errmsg, std::string> errmsg_info_str; 
 typedef boost::error_info<struct tag_errmsg, int> errmsg_info_int; 
 
-// for printing, may be disabled in optimized build
+using namespace boost;
+using namespace std;
 
-// #ifdef DIGEST_BASE64
-// #include <boost/archive/iterators/base64_from_binary.hpp>
-// #include <boost/archive/iterators/binary_from_base64.hpp>
-// #endif
+namespace Sync {
 
-#include <boost/archive/iterators/transform_width.hpp>
-#include <boost/iterator/transform_iterator.hpp>
-#include <boost/archive/iterators/dataflow_exception.hpp>
+DigestValue::DigestValue ()
+  : m_length (0)
+{
+  memset (m_buffer, 0, sizeof (m_buffer));
+}
 
-using namespace boost;
-using namespace boost::archive::iterators;
-using namespace std;
+DigestValue::DigestValue (const uint8_t *buffer, uint32_t length)
+  : m_length (length)
+{
+  if (length > MAX_SIZE)
+    BOOST_THROW_EXCEPTION (Error::DigestCalculationError ()
+                           << errmsg_info_str ("Hash value is too long")
+                           << errmsg_info_int (length));
 
-// Other options: VP_md2, EVP_md5, EVP_sha, EVP_sha1, EVP_sha256, EVP_dss, EVP_dss1, EVP_mdc2, EVP_ripemd160
-#define HASH_FUNCTION EVP_sha256
+  memset (m_buffer, 0, sizeof (m_buffer));
+  memcpy (m_buffer, buffer, length);
+}
 
+bool
+DigestValue::isZero () const
+{
+  if (m_length == 0)
+    BOOST_THROW_EXCEPTION (Error::DigestCalculationError ()
+                           << errmsg_info_str ("Digest has not been yet finalized"));
 
-// #ifndef DIGEST_BASE64
+  return (m_length == 1 && m_buffer[0] == 0);
+}
 
-template<class CharType>
-struct hex_from_4_bit
+std::size_t
+DigestValue::getHash () const
 {
-  typedef CharType result_type;
-  CharType operator () (CharType ch) const
-  {
-    const char *lookup_table = "0123456789abcdef";
-    // cout << "New character: " << (int) ch << " (" << (char) ch << ")" << "\n";
-    BOOST_ASSERT (ch < 16);
-    return lookup_table[static_cast<size_t>(ch)];
-  }
-};
+  if (isZero ()) return 0;
+  
+  if (sizeof (std::size_t) > m_length)
+    {
+      BOOST_THROW_EXCEPTION (Error::DigestCalculationError ()
+                             << errmsg_info_str ("Hash is not zero and length is less than size_t")
+                             << errmsg_info_int (m_length));
+    }
+  
+  // just getting first sizeof(std::size_t) bytes
+  // not ideal, but should work pretty well
+  std::size_t hash;
+  memcpy (&hash, m_buffer, sizeof (hash));
+  return hash;
+}
 
-typedef transform_iterator<hex_from_4_bit<string::const_iterator::value_type>,
-                           transform_width<string::const_iterator, 4, 8, string::const_iterator::value_type> > string_from_binary;
+bool
+DigestValue::operator == (const DigestValue &value) const
+{
+  if (m_length == 0)
+    BOOST_THROW_EXCEPTION (Error::DigestCalculationError ()
+                           << errmsg_info_str ("Digest1 is empty"));
 
+  if (value.m_length == 0)
+    BOOST_THROW_EXCEPTION (Error::DigestCalculationError ()
+                           << errmsg_info_str ("Digest2 is empty"));
+
+  // unused parts of the buffers are zero-filled, so hashes of different size will not match
+  return m_length == value.m_length && memcmp (m_buffer, value.m_buffer, MAX_SIZE) == 0;
+}
 
-template<class CharType>
-struct hex_to_4_bit
+void
+DigestValue::appendHex (std::string &str) const
 {
-  typedef CharType result_type;
-  CharType operator () (CharType ch) const
+  BOOST_ASSERT (m_length != 0);
+
+  char hex[2 * MAX_SIZE];
+  hexEncode (m_buffer, m_length, hex);
+  str.append (hex, 2 * m_length);
+}
+
+DigestValue
+DigestValue::fromHex (const char *hex, size_t length)
+{
+  if (length == 0)
+    BOOST_THROW_EXCEPTION (Error::DigestCalculationError ()
+                           << errmsg_info_str ("Input is empty"));
+
+  if (length > 2 * MAX_SIZE)
+    BOOST_THROW_EXCEPTION (Error::DigestCalculationError ()
+                           << errmsg_info_str ("Input is too long"));
+
+  uint8_t buffer[MAX_SIZE];
+  if (!hexDecode (hex, length, buffer))
+    BOOST_THROW_EXCEPTION (Error::DigestCalculationError ()
+                           << errmsg_info_str ("Input is not a valid hex string"));
+
+  return DigestValue (buffer, length / 2);
+}
+
+/**
+ * @brief Pool of hash engines that can be reused by short-lived Digest objects
+ */
+class HashContextPool
+{
+public:
+  ~HashContextPool ()
   {
-    const signed char lookup_table [] = {
-      -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
-      -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
-      -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
-      0, 1, 2, 3, 4, 5, 6, 7, 8, 9,-1,-1,-1,-1,-1,-1,
-      -1,10,11,12,13,14,15,-1,-1,-1,-1,-1,-1,-1,-1,-1,
-      -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
-      -1,10,11,12,13,14,15,-1,-1,-1,-1,-1,-1,-1,-1,-1,
-      -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
-    };
-
-    // cout << "New character: " << hex << (int) ch << " (" << (char) ch << ")" << "\n";
-    signed char value = -1;
-    if ((unsigned)ch < 128)
-      value = lookup_table [(unsigned)ch];
-    if (value == -1)
-      BOOST_THROW_EXCEPTION (Sync::Error::DigestCalculationError () << errmsg_info_int ((int)ch));
-    
-    return value;
+    for (std::vector<DigestEngine*>::iterator engine = m_engines.begin ();
+         engine != m_engines.end ();
+         engine++)
+      {
+        delete *engine;
+      }
   }
-};
 
-typedef transform_width<transform_iterator<hex_to_4_bit<string::const_iterator::value_type>, string::const_iterator>, 8, 4> string_to_binary;
+  DigestEngine *
+  acquire ()
+  {
+    if (m_engines.empty ())
+      return new DigestEngine;
+
+    DigestEngine *engine = m_engines.back ();
+    m_engines.pop_back ();
+    return engine;
+  }
 
-// #else
+  void
+  release (DigestEngine *engine)
+  {
+    if (m_engines.size () < m_maxPoolSize)
+      m_engines.push_back (engine);
+    else
+      delete engine;
+  }
 
-// typedef base64_from_binary<transform_width<string::const_iterator, 6, 8> > string_from_binary;
-// typedef binary_from_base64<transform_width<string::const_iterator, 8, 6> > string_to_binary;
+  static HashContextPool &
+  get ()
+  {
+    static boost::thread_specific_ptr<HashContextPool> pool;
+    if (pool.get () == 0)
+      pool.reset (new HashContextPool);
 
-// #endif
+    return *pool;
+  }
 
-namespace Sync {
+private:
+  static const size_t m_maxPoolSize = 16;
+  std::vector<DigestEngine*> m_engines;
+};
 
 Digest::Digest ()
-  : m_buffer (0)
-  , m_hashLength (0)
 {
-  m_context = EVP_MD_CTX_create ();
+  m_engine = HashContextPool::get ().acquire ();
 
   reset ();
 }
 
 Digest::~Digest ()
 {
-  if (m_buffer != 0)
-    delete [] m_buffer;
-
-  EVP_MD_CTX_destroy (m_context);
+  HashContextPool::get ().release (m_engine);
 }
 
 bool
 Digest::empty () const
 {
-  return m_buffer == 0;
+  return m_value.empty ();
 }
 
 bool
 Digest::isZero () const
 {
-  if (m_buffer == 0)
-    BOOST_THROW_EXCEPTION (Error::DigestCalculationError ()
-                           << errmsg_info_str ("Digest has not been yet finalized"));
-
-  return (m_hashLength == 1 && m_buffer[0] == 0);
+  return m_value.isZero ();
 }
 
 
 void
 Digest::reset ()
 {
-  if (m_buffer != 0)
-    {
-      delete [] m_buffer;
-      m_buffer = 0;
-    }
+  m_value = DigestValue ();
 
-  int ok = EVP_DigestInit_ex (m_context, HASH_FUNCTION (), 0);
-  if (!ok)
+  if (!m_engine->init ())
     BOOST_THROW_EXCEPTION (Error::DigestCalculationError ()
-                           << errmsg_info_str ("EVP_DigestInit_ex returned error")
-                           << errmsg_info_int (ok));
+                           << errmsg_info_str ("Hash engine initialization failed"));
 }
 
 
 void
 Digest::finalize ()
 {
-  if (m_buffer != 0) return;
+  if (!m_value.empty ()) return;
 
-  m_buffer = new uint8_t [EVP_MAX_MD_SIZE];
+  uint8_t buffer[MAX_DIGEST_SIZE];
+  uint32_t hashLength = 0;
 
-  int ok = EVP_DigestFinal_ex (m_context,
-			       m_buffer, &m_hashLength);
-  if (!ok)
+  if (!m_engine->finalize (buffer, hashLength))
     BOOST_THROW_EXCEPTION (Error::DigestCalculationError ()
-                           << errmsg_info_str ("EVP_DigestFinal_ex returned error")
-                           << errmsg_info_int (ok));
+                           << errmsg_info_str ("Hash engine finalization failed"));
+
+  m_value = DigestValue (buffer, hashLength);
+}
+
+const DigestValue &
+Digest::getValue () const
+{
+  if (m_value.empty ())
+    BOOST_THROW_EXCEPTION (Error::DigestCalculationError ()
+                           << errmsg_info_str ("Digest has not been yet finalized"));
+
+  return m_value;
 }
 
 std::size_t
 Digest::getHash () const
 {
-  if (isZero ()) return 0;
-  
-  if (sizeof (std::size_t) > m_hashLength)
-    {
-      BOOST_THROW_EXCEPTION (Error::DigestCalculationError ()
-                             << errmsg_info_str ("Hash is not zero and length is less than size_t")
-                             << errmsg_info_int (m_hashLength));
-    }
-  
-  // just getting first sizeof(std::size_t) bytes
-  // not ideal, but should work pretty well
-  return *(reinterpret_cast<std::size_t*> (m_buffer));
+  return m_value.getHash ();
 }
 
 bool
 Digest::operator == (const Digest &digest) const
 {
-  if (m_buffer == 0)
-    BOOST_THROW_EXCEPTION (Error::DigestCalculationError ()
-                           << errmsg_info_str ("Digest1 is empty"));
-
-  if (digest.m_buffer == 0)
-    BOOST_THROW_EXCEPTION (Error::DigestCalculationError ()
-                           << errmsg_info_str ("Digest2 is empty"));
-
-  if (m_hashLength != digest.m_hashLength)
-    return false;
-
-  // Allow different hash size
-  // BOOST_THROW_EXCEPTION (Error::DigestCalculationError ()
-  //                        << errmsg_info_str ("Digest lengths are not the same")
-  //                        << errmsg_info_int (m_hashLength)
-  //                        << errmsg_info_int (digest.m_hashLength));
-
-  return memcmp (m_buffer, digest.m_buffer, m_hashLength) == 0;
+  return m_value == digest.m_value;
 }
 
 
@@ -218,46 +259,100 @@ Digest::update (const uint8_t *buffer, size_t size)
   // cout << "Update: " << (void*)buffer << " / size: " << size << "\n";
   
   // cannot update Digest when it has been finalized
-  if (m_buffer != 0)
+  if (!m_value.empty ())
     BOOST_THROW_EXCEPTION (Error::DigestCalculationError ()
                            << errmsg_info_str ("Digest has been already finalized"));
 
-  bool ok = EVP_DigestUpdate (m_context, buffer, size);
+  if (!m_engine->update (buffer, size))
+    BOOST_THROW_EXCEPTION (Error::DigestCalculationError ()
+                           << errmsg_info_str ("Hash engine update failed"));
+}
+
+
+DigestValue
+Digest::hash (const void *buffer1, size_t size1,
+              const void *buffer2/* = 0*/, size_t size2/* = 0*/,
+              const void *buffer3/* = 0*/, size_t size3/* = 0*/)
+{
+  HashContextPool &pool = HashContextPool::get ();
+  DigestEngine *engine = pool.acquire ();
+
+  uint8_t buffer[MAX_DIGEST_SIZE];
+  uint32_t hashLength = 0;
+
+  bool ok =
+    engine->init () &&
+    engine->update (buffer1, size1) &&
+    (size2 == 0 || engine->update (buffer2, size2)) &&
+    (size3 == 0 || engine->update (buffer3, size3)) &&
+    engine->finalize (buffer, hashLength);
+
+  pool.release (engine);
+
   if (!ok)
     BOOST_THROW_EXCEPTION (Error::DigestCalculationError ()
-                           << errmsg_info_str ("EVP_DigestUpdate returned error")
-                           << errmsg_info_int (ok));
+                           << errmsg_info_str ("One-shot hash calculation failed"));
+
+  return DigestValue (buffer, hashLength);
 }
 
+void
+Digest::hashBatch (const uint8_t *const *buffers, size_t size, size_t count, DigestValue *values)
+{
+  size_t index = 0;
+
+#ifndef DIGEST_ENGINE_FAST
+  if (Sha256MultiBufferEngine::isSupported ())
+    {
+      const size_t LANES = Sha256MultiBufferEngine::LANES;
+      uint8_t digests[LANES * 32];
+
+      for (; index + LANES <= count; index += LANES)
+        {
+          Sha256MultiBufferEngine::hash (buffers + index, size, digests);
+          for (size_t lane = 0; lane < LANES; lane++)
+            values[index + lane] = DigestValue (digests + lane * 32, 32);
+        }
+    }
+#endif
+
+  // the rest (or everything, if multi-buffer hashing is not available)
+  for (; index < count; index++)
+    values[index] = hash (buffers[index], size);
+}
 
 Digest &
 Digest::operator << (const Digest &src)
 {
-  if (src.m_buffer == 0) 
+  return *this << src.getValue ();
+}
+
+Digest &
+Digest::operator << (const DigestValue &src)
+{
+  if (src.empty ()) 
     BOOST_THROW_EXCEPTION (Error::DigestCalculationError ()
                            << errmsg_info_str ("Digest has not been yet finalized"));
 
-  update (src.m_buffer, src.m_hashLength);
+  update (src.data (), src.size ());
 
   return *this;
 }
 
 std::ostream &
-operator << (std::ostream &os, const Digest &digest)
+operator << (std::ostream &os, const DigestValue &value)
 {
-  BOOST_ASSERT (digest.m_hashLength != 0);
-  
-  ostreambuf_iterator<char> out_it (os); // ostream iterator
-  // need to encode to base64
-  copy (string_from_binary (reinterpret_cast<const char*> (digest.m_buffer)),
-        string_from_binary (reinterpret_cast<const char*> (digest.m_buffer+digest.m_hashLength)),
-        out_it);
+  BOOST_ASSERT (value.size () != 0);
+
+  char hex[2 * DigestValue::MAX_SIZE];
+  hexEncode (value.data (), value.size (), hex);
+  os.write (hex, 2 * value.size ());
 
   return os;
 }
 
 std::istream &
-operator >> (std::istream &is, Digest &digest)
+operator >> (std::istream &is, DigestValue &value)
 {
   string str;
   is >> str; // read string first
@@ -266,24 +361,27 @@ operator >> (std::istream &is, Digest &digest)
     BOOST_THROW_EXCEPTION (Error::DigestCalculationError ()
                            << errmsg_info_str ("Input is empty"));
   
-  // uint8_t padding = (3 - str.size () % 3) % 3;
-  // for (uint8_t i = 0; i < padding; i++) str.push_back ('=');
-
   // only empty digest object can be used for reading
-  if (digest.m_buffer != 0)
+  if (!value.empty ())
     BOOST_THROW_EXCEPTION (Error::DigestCalculationError ()
                            << errmsg_info_str ("Digest has been already finalized"));
 
-  digest.m_buffer = new uint8_t [EVP_MAX_MD_SIZE];
-  uint8_t *end = copy (string_to_binary (str.begin ()),
-                       string_to_binary (str.end ()),
-                       digest.m_buffer);
-
-  digest.m_hashLength = end - digest.m_buffer;
+  value = DigestValue::fromHex (str.c_str (), str.size ());
 
   return is;
 }
 
+std::ostream &
+operator << (std::ostream &os, const Digest &digest)
+{
+  return os << digest.m_value;
+}
+
+std::istream &
+operator >> (std::istream &is, Digest &digest)
+{
+  return is >> digest.m_value;
+}
+
 
 } // Sync
-
@@ -24,14 +24,118 @@
 #define SYNC_DIGEST_H
 
 #include <boost/exception/all.hpp>
-#include <openssl/evp.h>
 #include <boost/cstdint.hpp>
+#include <string>
+#include <iostream>
 
 namespace Sync {
 
+class DigestEngine;
+
 /**
  * @ingroup sync
- * @brief A simple wrapper for libcrypto hash functions
+ * @brief Value of the finalized digest
+ *
+ * Digest value is stored inline (no heap allocations), so objects of this class
+ * can be freely copied and compared with memcmp.  Unused part of the buffer is always
+ * zero-filled.
+ */
+class DigestValue
+{
+public:
+  /**
+   * @brief Maximum size of the hash value (enough for SHA-256)
+   */
+  static const uint32_t MAX_SIZE = 32;
+
+  /**
+   * @brief Default constructor.  Creates an empty value
+   */
+  DigestValue ();
+
+  /**
+   * @brief Create value from the raw hash bytes
+   * @param buffer pointer to the hash bytes
+   * @param length number of hash bytes (should not exceed MAX_SIZE)
+   */
+  DigestValue (const uint8_t *buffer, uint32_t length);
+
+  /**
+   * @brief Check if value is empty
+   */
+  bool
+  empty () const { return m_length == 0; }
+
+  /**
+   * @brief Checks if the value is zero-root hash
+   *
+   * Zero-root hash is a valid hash that optimally represents an empty state
+   */
+  bool
+  isZero () const;
+
+  /**
+   * @brief Obtain a short version of the hash (just first sizeof(size_t) bytes)
+   */
+  std::size_t
+  getHash () const;
+
+  /**
+   * @brief Get pointer to the hash bytes
+   */
+  const uint8_t *
+  data () const { return m_buffer; }
+
+  /**
+   * @brief Get number of hash bytes
+   */
+  uint32_t
+  size () const { return m_length; }
+
+  /**
+   * @brief Compare two digest values
+   */
+  bool
+  operator == (const DigestValue &value) const;
+
+  bool
+  operator != (const DigestValue &value) const
+  { return ! (*this == value); }
+
+  /**
+   * @brief Append hex representation of the value to the string
+   *
+   * Same as (but cheaper than) printing the value to a stream
+   */
+  void
+  appendHex (std::string &str) const;
+
+  /**
+   * @brief Create value from its hex representation
+   * @param hex pointer to hex characters
+   * @param length number of characters
+   *
+   * Same as (but cheaper than) reading the value from a stream.  Throws
+   * DigestCalculationError if input is empty, too long, or is not a valid hex
+   */
+  static DigestValue
+  fromHex (const char *hex, size_t length);
+
+private:
+  uint8_t m_buffer[MAX_SIZE];
+  uint32_t m_length;
+};
+
+/**
+ * @ingroup sync
+ * @brief A simple wrapper for hash engines
+ *
+ * Digest objects are intended to be used only while the hash is being
+ * calculated.  Finalized hash should be stored as DigestValue (see getValue ())
+ *
+ * Hash engine (see sync-digest-engine.h) is selected at compile time.  Engine
+ * objects are not created for every Digest object, but taken from (and
+ * returned to) a per-thread pool
  */
 class Digest
 {
@@ -72,6 +176,12 @@ public:
   void
   finalize ();
 
+  /**
+   * @brief Get value of the finalized digest
+   */
+  const DigestValue &
+  getValue () const;
+
   /**
    * @brief Compare two full digests
    *
@@ -94,6 +204,13 @@ public:
   Digest &
   operator << (const Digest &src);
 
+  /**
+   * @brief Add value of existing digest to digest calculation
+   * @param src digest value to combine with
+   */
+  Digest &
+  operator << (const DigestValue &src);
+
   /**
    * @brief Add string to digest calculation
    * @param str string to put into digest
@@ -115,10 +232,35 @@ public:
    */
   bool
   isZero () const;
+
+  /**
+   * @brief Calculate hash of (concatenation of) up to three buffers in one shot
+   *
+   * This call is equivalent to, but cheaper than, creating a Digest object,
+   * adding buffers to it, and finalizing it
+   */
+  static DigestValue
+  hash (const void *buffer1, size_t size1,
+        const void *buffer2 = 0, size_t size2 = 0,
+        const void *buffer3 = 0, size_t size3 = 0);
+
+  /**
+   * @brief Calculate hashes of many independent buffers of the same size
+   * @param buffers array of count pointers to the buffers
+   * @param size size of each buffer
+   * @param count number of buffers
+   * @param values output array of count hash values
+   *
+   * If SHA-256 engine is used, buffers are hashed in parallel lanes (see
+   * Sha256MultiBufferEngine).  Result is the same as calling hash () for each buffer
+   */
+  static void
+  hashBatch (const uint8_t *const *buffers, size_t size, size_t count, DigestValue *values);
   
 private:
   Digest &
   operator = (Digest &digest) { (void)digest; return *this; }
+  Digest (const Digest &digest);
   
   /**
    * @brief Add size bytes of buffer to the hash
@@ -133,18 +275,14 @@ private:
   operator >> (std::istream &is, Digest &digest);
   
 private:
-  EVP_MD_CTX *m_context;
-  uint8_t *m_buffer;
-  uint32_t m_hashLength;
+  DigestEngine *m_engine;
+  DigestValue m_value;
 };
 
 namespace Error {
 struct DigestCalculationError : virtual boost::exception, virtual std::exception { };
 }
 
-typedef boost::shared_ptr<Digest> DigestPtr;
-typedef boost::shared_ptr<const Digest> DigestConstPtr;
-
 Digest &
 Digest::operator << (const std::string &str)
 {
@@ -165,34 +303,20 @@ operator << (std::ostream &os, const Digest &digest);
 std::istream &
 operator >> (std::istream &is, Digest &digest);
 
-// template<class INT>
-// Digest &
-// Digest::operator << (INT value)
-// {
-//   update (&value, sizeof (INT));
-//   return *this;
-// }
+std::ostream &
+operator << (std::ostream &os, const DigestValue &value);
 
-struct DigestPtrHash : public std::unary_function<Digest, std::size_t>
-{
-  std::size_t
-  operator() (DigestConstPtr digest) const
-  {
-    // std::cout << "digest->getHash: " << digest->getHash () << " (" << *digest << ")" << std::endl;
-    return digest->getHash ();
-  }
-};
+std::istream &
+operator >> (std::istream &is, DigestValue &value);
 
-struct DigestPtrEqual : public std::unary_function<Digest, std::size_t>
+/**
+ * @brief Hash function for DigestValue (to be used with boost::hash and hashed indices)
+ */
+inline std::size_t
+hash_value (const DigestValue &value)
 {
-  bool
-  operator() (DigestConstPtr digest1, DigestConstPtr digest2) const
-  {
-    // std::cout << boost::cref(*digest1) << " == " << boost::cref(*digest2) << " : " << (*digest1 == *digest2) << std::endl;
-    return *digest1 == *digest2;
-  }
-};
-
+  return value.getHash ();
+}
 
 } // Sync
 
@@ -0,0 +1,429 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Zhenkai Zhu <zhenkai@cs.ucla.edu>
+ *         Chaoyi Bian <bcy@pku.edu.cn>
+ *	   Alexander Afanasyev <alexander.afanasyev@ucla.edu>
+ */
+
+#ifndef SYNC_FLAT_LEAF_CONTAINER_H
+#define SYNC_FLAT_LEAF_CONTAINER_H
+
+#include "sync-leaf.h"
+#include "sync-name-info.h"
+#include "sync-object-pool.h"
+
+#include <boost/iterator/permutation_iterator.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/assert.hpp>
+#include <algorithm>
+#include <vector>
+#include <utility>
+
+namespace Sync {
+
+/**
+ * \ingroup sync
+ * @brief Flat (cache-friendly) container for SYNC leaves of type LeafType
+ *
+ * Leaves are kept in a contiguous array with an open-addressing (linear
+ * probing) hash index keyed by NameInfo::getHashId ().  Name order is
+ * maintained as a separate array of positions, which is sorted (and cleaned
+ * from removed leaves) lazily, only when ordered view is requested after
+ * leaves have been added or removed.
+ *
+ * Provides the subset of multi_index_container interface that is used for
+ * LeafContainer: find, insert, erase, modify, iteration (in no particular
+ * order) and get<ordered> () (iteration in name order).
+ *
+ * Iterators are invalidated by insert and erase.  All arrays are allocated
+ * from the pool given to the constructor (if any).
+ */
+template<class LeafType>
+class FlatLeafContainer
+{
+public:
+  typedef boost::shared_ptr<LeafType> value_type;
+
+private:
+  typedef std::vector<value_type, PoolAllocator<value_type> > Leaves;
+  typedef std::vector<uint32_t, PoolAllocator<uint32_t> > Positions;
+
+public:
+  typedef typename Leaves::const_iterator iterator;
+  typedef iterator const_iterator;
+  typedef typename Leaves::size_type size_type;
+
+  /**
+   * @brief View of the container with leaves ordered by name
+   */
+  class OrderedIndex
+  {
+  public:
+    typedef boost::permutation_iterator<typename Leaves::const_iterator,
+                                        typename Positions::const_iterator> iterator;
+    typedef iterator const_iterator;
+
+    iterator
+    begin () const
+    {
+      m_container->sortOrder ();
+      return iterator (m_container->m_leaves.begin (), m_container->m_order.begin ());
+    }
+
+    iterator
+    end () const
+    {
+      m_container->sortOrder ();
+      return iterator (m_container->m_leaves.begin (), m_container->m_order.end ());
+    }
+
+    size_type
+    size () const { return m_container->size (); }
+
+    bool
+    empty () const { return m_container->empty (); }
+
+  private:
+    OrderedIndex (const FlatLeafContainer *container) : m_container (container) { }
+    friend class FlatLeafContainer;
+
+  private:
+    const FlatLeafContainer *m_container;
+  };
+
+public:
+  /**
+   * @brief Constructor
+   * @param pool pool to allocate arrays from (global heap if not set)
+   */
+  FlatLeafContainer (const ObjectPoolPtr &pool = ObjectPoolPtr ())
+    : m_leaves (PoolAllocator<value_type> (pool))
+    , m_slots (PoolAllocator<Slot> (pool))
+    , m_order (PoolAllocator<uint32_t> (pool))
+    , m_orderOf (PoolAllocator<uint32_t> (pool))
+    , m_sortedCount (0)
+    , m_removedCount (0)
+  {
+  }
+
+  iterator
+  begin () const { return m_leaves.begin (); }
+
+  iterator
+  end () const { return m_leaves.end (); }
+
+  size_type
+  size () const { return m_leaves.size (); }
+
+  bool
+  empty () const { return m_leaves.empty (); }
+
+  /**
+   * @brief Find leaf with the name
+   * @returns iterator to the leaf or end ()
+   */
+  iterator
+  find (NameInfoConstPtr info) const;
+
+  /**
+   * @brief Insert leaf, unless there is already a leaf with the same name
+   * @returns iterator to the leaf with the name and flag whether insertion happened
+   */
+  std::pair<iterator, bool>
+  insert (const value_type &leaf);
+
+  /**
+   * @brief Remove the leaf
+   */
+  void
+  erase (iterator position);
+
+  /**
+   * @brief Remove leaf with the name (if any)
+   * @returns number of removed leaves
+   */
+  size_type
+  erase (NameInfoConstPtr info);
+
+  /**
+   * @brief Modify the leaf
+   *
+   * Modifier should not change the name of the leaf
+   */
+  template<class Modifier>
+  bool
+  modify (iterator position, Modifier mod)
+  {
+    mod (m_leaves[position - m_leaves.begin ()]);
+    return true;
+  }
+
+  /**
+   * @brief Remove all leaves
+   */
+  void
+  clear ();
+
+  /**
+   * @brief Get view of the container ordered by name
+   *
+   * Tag is accepted for compatibility with multi_index_container, the only
+   * supported view is `ordered'
+   */
+  template<class Tag>
+  OrderedIndex
+  get () const { return OrderedIndex (this); }
+
+private:
+  struct Slot
+  {
+    std::size_t hash;
+    const NameInfo *info;
+    uint32_t position; ///< @brief position of the leaf in m_leaves plus one, 0 for empty slot
+  };
+
+  static const uint32_t REMOVED = ~static_cast<uint32_t> (0);
+
+  static std::size_t
+  hashOf (const NameInfo &info)
+  {
+    // IDs are taken from name digests (see StdNameInfo) and are already
+    // well mixed; multiplicative (Fibonacci) hashing only keeps low bits of
+    // the slot index from depending on the low bits of the ID alone
+    return static_cast<std::size_t> (info.getHashId () * 0x9E3779B97F4A7C15ULL >> 16);
+  }
+
+  std::size_t
+  findSlot (const NameInfo &info, std::size_t hash) const;
+
+  std::size_t
+  findSlotByPosition (std::size_t hash, uint32_t position) const;
+
+  void
+  rehash (std::size_t capacity);
+
+  void
+  sortOrder () const;
+
+  struct CompareByName
+  {
+    CompareByName (const Leaves &leaves) : m_leaves (leaves) { }
+
+    bool
+    operator () (uint32_t position1, uint32_t position2) const
+    {
+      return *m_leaves[position1]->getInfo () < *m_leaves[position2]->getInfo ();
+    }
+
+    const Leaves &m_leaves;
+  };
+
+private:
+  Leaves m_leaves;
+  std::vector<Slot, PoolAllocator<Slot> > m_slots; ///< @brief hash index (size is power of two, at most half full)
+
+  mutable Positions m_order; ///< @brief positions of leaves in name order (only first m_sortedCount are sorted, REMOVED for removed leaves)
+  mutable Positions m_orderOf; ///< @brief index in m_order for every leaf
+  mutable std::size_t m_sortedCount;
+  mutable std::size_t m_removedCount; ///< @brief number of REMOVED elements in m_order
+};
+
+template<class LeafType>
+std::size_t
+FlatLeafContainer<LeafType>::findSlot (const NameInfo &info, std::size_t hash) const
+{
+  std::size_t mask = m_slots.size () - 1;
+  for (std::size_t slot = hash & mask; ; slot = (slot + 1) & mask)
+    {
+      const Slot &item = m_slots[slot];
+      if (item.position == 0 ||
+          (item.hash == hash && (item.info == &info || *item.info == info)))
+        return slot;
+    }
+}
+
+template<class LeafType>
+std::size_t
+FlatLeafContainer<LeafType>::findSlotByPosition (std::size_t hash, uint32_t position) const
+{
+  std::size_t mask = m_slots.size () - 1;
+  for (std::size_t slot = hash & mask; ; slot = (slot + 1) & mask)
+    {
+      BOOST_ASSERT (m_slots[slot].position != 0);
+      if (m_slots[slot].position == position)
+        return slot;
+    }
+}
+
+template<class LeafType>
+typename FlatLeafContainer<LeafType>::iterator
+FlatLeafContainer<LeafType>::find (NameInfoConstPtr info) const
+{
+  if (m_leaves.empty ())
+    return end ();
+
+  const Slot &slot = m_slots[findSlot (*info, hashOf (*info))];
+  if (slot.position == 0)
+    return end ();
+
+  return m_leaves.begin () + (slot.position - 1);
+}
+
+template<class LeafType>
+std::pair<typename FlatLeafContainer<LeafType>::iterator, bool>
+FlatLeafContainer<LeafType>::insert (const value_type &leaf)
+{
+  if (2 * (m_leaves.size () + 1) > m_slots.size ())
+    rehash (std::max<std::size_t> (16, 2 * m_slots.size ()));
+
+  std::size_t hash = hashOf (*leaf->getInfo ());
+  Slot &slot = m_slots[findSlot (*leaf->getInfo (), hash)];
+  if (slot.position != 0)
+    return std::make_pair (m_leaves.begin () + (slot.position - 1), false);
+
+  m_leaves.push_back (leaf);
+  slot.hash = hash;
+  slot.info = leaf->getInfo ().get ();
+  slot.position = m_leaves.size ();
+  m_orderOf.push_back (m_order.size ());
+  m_order.push_back (m_leaves.size () - 1);
+
+  return std::make_pair (m_leaves.end () - 1, true);
+}
+
+template<class LeafType>
+void
+FlatLeafContainer<LeafType>::erase (iterator position)
+{
+  uint32_t index = position - m_leaves.begin ();
+  uint32_t last = m_leaves.size () - 1;
+  std::size_t mask = m_slots.size () - 1;
+
+  // backward-shift deletion from the hash index (no tombstones)
+  std::size_t hole = findSlotByPosition (hashOf (*m_leaves[index]->getInfo ()), index + 1);
+  for (std::size_t slot = (hole + 1) & mask; m_slots[slot].position != 0; slot = (slot + 1) & mask)
+    {
+      std::size_t ideal = m_slots[slot].hash & mask;
+      if (((slot - ideal) & mask) >= ((slot - hole) & mask))
+        {
+          m_slots[hole] = m_slots[slot];
+          hole = slot;
+        }
+    }
+  m_slots[hole].position = 0;
+
+  // only mark as removed in the name order, it will be cleaned up lazily
+  m_order[m_orderOf[index]] = REMOVED;
+  m_removedCount ++;
+
+  // move the last leaf into the freed position
+  if (index != last)
+    {
+      m_slots[findSlotByPosition (hashOf (*m_leaves[last]->getInfo ()), last + 1)].position = index + 1;
+      m_order[m_orderOf[last]] = index;
+      m_orderOf[index] = m_orderOf[last];
+      m_leaves[index].swap (m_leaves[last]);
+    }
+  m_orderOf.pop_back ();
+  m_leaves.pop_back ();
+}
+
+template<class LeafType>
+typename FlatLeafContainer<LeafType>::size_type
+FlatLeafContainer<LeafType>::erase (NameInfoConstPtr info)
+{
+  iterator item = find (info);
+  if (item == end ())
+    return 0;
+
+  erase (item);
+  return 1;
+}
+
+template<class LeafType>
+void
+FlatLeafContainer<LeafType>::clear ()
+{
+  m_leaves.clear ();
+  m_slots.clear ();
+  m_order.clear ();
+  m_orderOf.clear ();
+  m_sortedCount = 0;
+  m_removedCount = 0;
+}
+
+template<class LeafType>
+void
+FlatLeafContainer<LeafType>::rehash (std::size_t capacity)
+{
+  Slot empty = { 0, 0, 0 };
+  m_slots.assign (capacity, empty);
+
+  std::size_t mask = capacity - 1;
+  for (uint32_t position = 0; position < m_leaves.size (); position++)
+    {
+      std::size_t hash = hashOf (*m_leaves[position]->getInfo ());
+      std::size_t slot = hash & mask;
+      while (m_slots[slot].position != 0)
+        slot = (slot + 1) & mask;
+
+      m_slots[slot].hash = hash;
+      m_slots[slot].info = m_leaves[position]->getInfo ().get ();
+      m_slots[slot].position = position + 1;
+    }
+}
+
+template<class LeafType>
+void
+FlatLeafContainer<LeafType>::sortOrder () const
+{
+  if (m_sortedCount == m_order.size () && m_removedCount == 0)
+    return;
+
+  // drop removed leaves, preserving order of the rest
+  if (m_removedCount > 0)
+    {
+      std::size_t sortedCount = 0;
+      typename Positions::iterator out = m_order.begin ();
+      for (typename Positions::iterator item = m_order.begin (); item != m_order.end (); item++)
+        {
+          if (*item == REMOVED)
+            continue;
+
+          if (static_cast<std::size_t> (item - m_order.begin ()) < m_sortedCount)
+            sortedCount ++;
+          *out++ = *item;
+        }
+      m_order.erase (out, m_order.end ());
+      m_sortedCount = sortedCount;
+      m_removedCount = 0;
+    }
+
+  // sort newly added leaves and merge them with already sorted ones
+  CompareByName compare (m_leaves);
+  std::sort (m_order.begin () + m_sortedCount, m_order.end (), compare);
+  std::inplace_merge (m_order.begin (), m_order.begin () + m_sortedCount, m_order.end (), compare);
+  m_sortedCount = m_order.size ();
+
+  for (std::size_t i = 0; i < m_order.size (); i++)
+    m_orderOf[m_order[i]] = i;
+}
+
+} // Sync
+
+#endif // SYNC_FLAT_LEAF_CONTAINER_H
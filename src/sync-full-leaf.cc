@@ -22,6 +22,8 @@
 
 #include "sync-full-leaf.h"
 #include <boost/ref.hpp>
+#include <boost/assert.hpp>
+#include <string.h>
 
 using namespace boost;
 
@@ -33,20 +35,85 @@ FullLeaf::FullLeaf (NameInfoConstPtr info, const SeqNo &seq)
   updateDigest ();
 }
 
+FullLeaf::FullLeaf (NameInfoConstPtr info, const SeqNo &seq, const DigestValue &digest)
+  : Leaf (info, seq)
+  , m_digest (digest)
+{
+}
+
 void
 FullLeaf::updateDigest ()
 {
-  m_digest.reset ();
-  m_digest << getInfo ()->getDigest () << *getSeq ().getDigest ();
-  m_digest.finalize ();
+  const DigestValue &nameDigest = getInfo ()->getDigest ();
+  DigestValue seqDigest = getSeq ().getDigest ();
+
+  m_digest = Digest::hash (nameDigest.data (), nameDigest.size (),
+                           seqDigest.data (), seqDigest.size ());
 }
 
 // from Leaf
 void
 FullLeaf::setSeq (const SeqNo &seq)
 {
+  // Leaf::setSeq keeps the largest sequence number, nothing to recalculate otherwise
+  if (!(getSeq () < seq))
+    return;
+
   Leaf::setSeq (seq);
   updateDigest ();
 }
 
+void
+FullLeaf::setSeq (const SeqNo &seq, const DigestValue &digest)
+{
+  Leaf::setSeq (seq);
+  m_digest = digest;
+}
+
+void
+FullLeaf::calculateDigests (const std::vector<NameInfoConstPtr> &infos,
+                            const std::vector<SeqNo> &seqs,
+                            std::vector<DigestValue> &digests)
+{
+  BOOST_ASSERT (infos.size () == seqs.size ());
+
+  size_t count = infos.size ();
+  digests.resize (count);
+  if (count == 0)
+    return;
+
+  std::vector<const uint8_t*> buffers (count);
+
+  // hash (session, seq) pairs, the same as SeqNo::getDigest
+  std::vector<uint32_t> seqValues (2 * count);
+  for (size_t i = 0; i < count; i++)
+    {
+      seqValues[2*i]   = seqs[i].getSession ();
+      seqValues[2*i+1] = seqs[i].getSeq ();
+      buffers[i] = reinterpret_cast<const uint8_t*> (&seqValues[2*i]);
+    }
+
+  std::vector<DigestValue> seqDigests (count);
+  Digest::hashBatch (&buffers[0], 2 * sizeof (uint32_t), count, &seqDigests[0]);
+
+  // hash (name digest, seq digest) pairs, the same as updateDigest ()
+  // all digests are calculated by the same engine, so they have the same size
+  size_t nameSize = infos[0]->getDigest ().size ();
+  size_t seqSize = seqDigests[0].size ();
+
+  std::vector<uint8_t> leafValues (count * (nameSize + seqSize));
+  for (size_t i = 0; i < count; i++)
+    {
+      const DigestValue &nameDigest = infos[i]->getDigest ();
+      BOOST_ASSERT (nameDigest.size () == nameSize && seqDigests[i].size () == seqSize);
+
+      uint8_t *value = &leafValues[i * (nameSize + seqSize)];
+      memcpy (value, nameDigest.data (), nameSize);
+      memcpy (value + nameSize, seqDigests[i].data (), seqSize);
+      buffers[i] = value;
+    }
+
+  Digest::hashBatch (&buffers[0], nameSize + seqSize, count, &digests[0]);
+}
+
 } // Sync
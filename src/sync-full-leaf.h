@@ -24,6 +24,7 @@
 #define SYNC_FULL_LEAF_H
 
 #include "sync-leaf.h"
+#include <vector>
 
 namespace Sync {
 
@@ -40,6 +41,14 @@ public:
    * @param seq  Initial sequence number of the pointer
    */
   FullLeaf (NameInfoConstPtr info, const SeqNo &seq);
+
+  /**
+   * @brief Constructor for the case when leaf digest is already known
+   * @param info Smart pointer to leaf's name
+   * @param seq  Initial sequence number of the pointer
+   * @param digest Leaf digest, as calculated by calculateDigests ()
+   */
+  FullLeaf (NameInfoConstPtr info, const SeqNo &seq, const DigestValue &digest);
   virtual ~FullLeaf () { }
 
   /**
@@ -48,19 +57,41 @@ public:
    * The underlying Digest object is recalculated on every update or removal
    * (including updates of child classes)
    */
-  const Digest &
-  getDigest () const { return m_digest; }  
+  const DigestValue &
+  getDigest () const { return m_digest; }
 
   // from Leaf
   virtual void
   setSeq (const SeqNo &seq);
+
+  /**
+   * @brief Update sequence number when the new leaf digest is already known
+   * @param seq Sequence number (should be larger than the current one)
+   * @param digest Leaf digest, as calculated by calculateDigests ()
+   */
+  void
+  setSeq (const SeqNo &seq, const DigestValue &digest);
+
+  /**
+   * @brief Calculate digests of many leaves at once
+   * @param infos names of the leaves
+   * @param seqs sequence numbers of the leaves (the same number of elements as in infos)
+   * @param digests leaf digests (output)
+   *
+   * Calculation uses Digest::hashBatch, which is much faster than constructing
+   * leaves one by one when there are many of them
+   */
+  static void
+  calculateDigests (const std::vector<NameInfoConstPtr> &infos,
+                    const std::vector<SeqNo> &seqs,
+                    std::vector<DigestValue> &digests);
   
 private:
   void
   updateDigest ();
 
 private:
-  Digest m_digest;
+  DigestValue m_digest;
 };
 
 typedef boost::shared_ptr<FullLeaf> FullLeafPtr;
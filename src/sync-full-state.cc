@@ -32,16 +32,18 @@
 #include <boost/foreach.hpp>
 #include <boost/assert.hpp>
 
-#include "sync-full-leaf.h"
-
 using namespace boost;
 namespace ll = boost::lambda;
 
 namespace Sync {
 
 
-FullState::FullState ()
+FullState::FullState (DigestMode mode, const ObjectPoolPtr &pool)
 // m_lastUpdated is initialized to "not_a_date_time" in normal lib mode and to "0" time in NS-3 mode
+  : m_pool (pool)
+  , m_allocator (pool)
+  , m_leaves (pool)
+  , m_digestMode (mode)
 {
 }
 
@@ -59,26 +61,56 @@ FullState::getTimeFromLastUpdate () const
 #endif // NS3_MODULE
 }
 
-DigestConstPtr
+void
+FullState::setDigestMode (DigestMode mode)
+{
+  if (m_digestMode == mode)
+    return;
+
+  m_digestMode = mode;
+  m_digest = DigestValue ();
+
+  m_leavesSum.clear ();
+  m_merkleTree.clear ();
+  for (LeafContainer<FullLeaf>::iterator item = m_leaves.begin (); item != m_leaves.end (); item++)
+    {
+      if (m_digestMode == INCREMENTAL_DIGEST)
+        m_leavesSum += (*item)->getDigest ();
+      else if (m_digestMode == MERKLE_DIGEST)
+        m_merkleTree.insert ((*item)->getInfo (), item->get ());
+    }
+}
+
+const DigestValue &
 FullState::getDigest ()
 {
-  if (m_digest == 0)
+  if (m_digest.empty ())
     {
-      m_digest = make_shared<Digest> ();
       if (m_leaves.get<ordered> ().size () > 0)
         {
-          BOOST_FOREACH (LeafConstPtr leaf, m_leaves.get<ordered> ())
+          Digest digest;
+          if (m_digestMode == INCREMENTAL_DIGEST)
+            {
+              digest << m_leavesSum;
+            }
+          else if (m_digestMode == MERKLE_DIGEST)
             {
-              FullLeafConstPtr fullLeaf = dynamic_pointer_cast<const FullLeaf> (leaf);
-              BOOST_ASSERT (fullLeaf != 0);
-              *m_digest << fullLeaf->getDigest ();
+              digest << m_merkleTree.getRoot ()->getDigest ();
             }
-          m_digest->finalize ();
+          else
+            {
+              BOOST_FOREACH (const FullLeafPtr &leaf, m_leaves.get<ordered> ())
+                {
+                  digest << leaf->getDigest ();
+                }
+            }
+          digest.finalize ();
+          m_digest = digest.getValue ();
         }
       else
         {
-          std::istringstream is ("00"); //zero state
-          is >> *m_digest;
+          uint8_t zero = 0;
+          m_digest = DigestValue (&zero, 1); //zero state
         }
     }
 
@@ -95,12 +127,18 @@ FullState::update (NameInfoConstPtr info, const SeqNo &seq)
   m_lastUpdated = boost::posix_time::second_clock::universal_time ();
 #endif // NS3_MODULE
 
-  m_digest.reset ();
+  m_digest = DigestValue ();
 
-  LeafContainer::iterator item = m_leaves.find (info);
+  LeafContainer<FullLeaf>::iterator item = m_leaves.find (info);
   if (item == m_leaves.end ())
     {
-      m_leaves.insert (make_shared<FullLeaf> (info, cref (seq)));
+      FullLeafPtr leaf = allocate_shared<FullLeaf> (m_allocator, info, cref (seq));
+      m_leaves.insert (leaf);
+      if (m_digestMode == INCREMENTAL_DIGEST)
+        m_leavesSum += leaf->getDigest ();
+      else if (m_digestMode == MERKLE_DIGEST)
+        m_merkleTree.insert (info, leaf.get ());
+
       return make_tuple (true, false, SeqNo ());
     }
   else
@@ -111,12 +149,107 @@ FullState::update (NameInfoConstPtr info, const SeqNo &seq)
         }
 
       SeqNo old = (*item)->getSeq ();
+      if (m_digestMode == INCREMENTAL_DIGEST)
+        m_leavesSum -= (*item)->getDigest ();
+
       m_leaves.modify (item,
                        ll::bind (&Leaf::setSeq, *ll::_1, seq));
+
+      if (m_digestMode == INCREMENTAL_DIGEST)
+        m_leavesSum += (*item)->getDigest ();
+      else if (m_digestMode == MERKLE_DIGEST)
+        m_merkleTree.update (info);
       return make_tuple (false, true, old);
     }
 }
 
+void
+FullState::updateBatch (const std::vector<NameInfoConstPtr> &infos,
+                        const std::vector<SeqNo> &seqs,
+                        std::vector<boost::tuple<bool/*inserted*/, bool/*updated*/, SeqNo/*oldSeqNo*/> > &results)
+{
+  BOOST_ASSERT (infos.size () == seqs.size ());
+
+#ifdef NS3_MODULE
+  m_lastUpdated = ns3::Simulator::Now ();
+#else
+  m_lastUpdated = boost::posix_time::second_clock::universal_time ();
+#endif // NS3_MODULE
+
+  results.assign (infos.size (), make_tuple (false, false, SeqNo ()));
+
+  // Apply sequence numbers first, leaving digests of changed leaves empty (the
+  // same name can appear several times, but will be hashed only once)
+  std::vector<FullLeaf*> changedLeaves;
+  std::vector<bool> newLeaves;
+
+  for (size_t i = 0; i < infos.size (); i++)
+    {
+      LeafContainer<FullLeaf>::iterator item = m_leaves.find (infos[i]);
+      if (item == m_leaves.end ())
+        {
+          FullLeafPtr leaf = allocate_shared<FullLeaf> (m_allocator, infos[i], cref (seqs[i]), DigestValue ());
+          m_leaves.insert (leaf);
+
+          changedLeaves.push_back (leaf.get ());
+          newLeaves.push_back (true);
+          results[i] = make_tuple (true, false, SeqNo ());
+          continue;
+        }
+
+      FullLeaf *leaf = item->get ();
+
+      SeqNo old = leaf->getSeq ();
+      if (!(old < seqs[i]))
+        continue; // the same as in update (): old or duplicate sequence number
+
+      results[i] = make_tuple (false, true, old);
+
+      if (!leaf->getDigest ().empty ())
+        {
+          if (m_digestMode == INCREMENTAL_DIGEST)
+            m_leavesSum -= leaf->getDigest ();
+
+          changedLeaves.push_back (leaf);
+          newLeaves.push_back (false);
+        }
+
+      // leaf name (the only key of the container) does not change
+      leaf->setSeq (seqs[i], DigestValue ());
+    }
+
+  if (changedLeaves.empty ())
+    return;
+
+  m_digest = DigestValue ();
+
+  std::vector<NameInfoConstPtr> changedInfos (changedLeaves.size ());
+  std::vector<SeqNo> changedSeqs (changedLeaves.size ());
+  for (size_t i = 0; i < changedLeaves.size (); i++)
+    {
+      changedInfos[i] = changedLeaves[i]->getInfo ();
+      changedSeqs[i] = changedLeaves[i]->getSeq ();
+    }
+
+  std::vector<DigestValue> digests;
+  FullLeaf::calculateDigests (changedInfos, changedSeqs, digests);
+
+  for (size_t i = 0; i < changedLeaves.size (); i++)
+    {
+      changedLeaves[i]->setSeq (changedSeqs[i], digests[i]);
+
+      if (m_digestMode == INCREMENTAL_DIGEST)
+        m_leavesSum += digests[i];
+      else if (m_digestMode == MERKLE_DIGEST)
+        {
+          if (newLeaves[i])
+            m_merkleTree.insert (changedInfos[i], changedLeaves[i]);
+          else
+            m_merkleTree.update (changedInfos[i]);
+        }
+    }
+}
+
 bool
 FullState::remove (NameInfoConstPtr info)
 {
@@ -126,11 +259,16 @@ FullState::remove (NameInfoConstPtr info)
   m_lastUpdated = boost::posix_time::second_clock::universal_time ();
 #endif // NS3_MODULE
 
-  m_digest.reset ();
+  m_digest = DigestValue ();
 
-  LeafContainer::iterator item = m_leaves.find (info);
+  LeafContainer<FullLeaf>::iterator item = m_leaves.find (info);
   if (item != m_leaves.end ())
     {
+      if (m_digestMode == INCREMENTAL_DIGEST)
+        m_leavesSum -= (*item)->getDigest ();
+      else if (m_digestMode == MERKLE_DIGEST)
+        m_merkleTree.remove (info);
+
       m_leaves.erase (item);
       return true;
     }
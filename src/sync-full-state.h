@@ -34,6 +34,10 @@ typedef boost::posix_time::time_duration TimeDurationType;
 #endif // NS3_MODULE
 
 #include "sync-state.h"
+#include "sync-full-leaf.h"
+#include "sync-digest-sum.h"
+#include "sync-merkle-tree.h"
+#include <vector>
 
 namespace Sync {
 
@@ -49,12 +53,40 @@ typedef boost::shared_ptr<FullState> FullStateConstPtr;
 class FullState : public State
 {
 public:
+  /**
+   * @brief Method to calculate the root digest of the state
+   *
+   * All participants of the same sync group must use the same method
+   */
+  enum DigestMode
+    {
+      ORDERED_DIGEST,    ///< @brief hash of all leaf digests in name order (recalculated in O(N) after each change)
+      INCREMENTAL_DIGEST, ///< @brief hash of the commutative sum of leaf digests (adjusted in O(1) on each change)
+      MERKLE_DIGEST       ///< @brief root of the Merkle tree over leaves in name order (O(log N) re-hashing on each change)
+    };
+
   /**
    * @brief Default constructor
+   * @param mode method to calculate the root digest
+   * @param pool pool to allocate leaves from (global heap if not set)
    */
-  FullState ();
+  FullState (DigestMode mode = ORDERED_DIGEST, const ObjectPoolPtr &pool = ObjectPoolPtr ());
   virtual ~FullState ();
 
+  /**
+   * @brief Get method that is used to calculate the root digest
+   */
+  DigestMode
+  getDigestMode () const { return m_digestMode; }
+
+  /**
+   * @brief Change method that is used to calculate the root digest
+   *
+   * If state is not empty, the sum of leaf digests will be recalculated from scratch
+   */
+  void
+  setDigestMode (DigestMode mode);
+
   /**
    * @brief Get time period since last state update
    *
@@ -66,10 +98,27 @@ public:
   /**
    * @brief Obtain a read-only copy of the digest
    *
-   * If m_digest is 0, then it is automatically created.  On every update and removal, m_digest is reset to 0
+   * If m_digest is empty, then it is automatically calculated.  On every update and removal, m_digest is reset
+   *
+   * In INCREMENTAL_DIGEST and MERKLE_DIGEST modes recreation of m_digest costs a single hash
+   * of m_leavesSum or of the Merkle tree root, which are kept up to date by update() and remove()
    */
-  DigestConstPtr
+  const DigestValue &
   getDigest ();
+
+  /**
+   * @brief Get Merkle tree of the state (maintained only in MERKLE_DIGEST mode)
+   *
+   * Subtree digests of the tree can be used to find which part of the state differs
+   */
+  const MerkleTree &
+  getMerkleTree () const { return m_merkleTree; }
+
+  /**
+   * @brief Get state leaves
+   */
+  const LeafContainer<FullLeaf> &
+  getLeaves () const { return m_leaves; }
   
   // from State
   virtual boost::tuple<bool/*inserted*/, bool/*updated*/, SeqNo/*oldSeqNo*/>
@@ -77,12 +126,53 @@ public:
 
   virtual bool
   remove (NameInfoConstPtr info);
+
+  /**
+   * @brief Apply many updates at once
+   * @param infos names of the leaves
+   * @param seqs new sequence numbers (the same number of elements as in infos)
+   * @param results result of every update, as would be returned by update ()
+   *
+   * The result is the same as calling update () for every (info, seq) pair in
+   * order, but digests of all new and changed leaves are calculated in a batch
+   * (see FullLeaf::calculateDigests).  Intended for applying large state
+   * messages, e.g., full state received after joining the group
+   */
+  void
+  updateBatch (const std::vector<NameInfoConstPtr> &infos,
+               const std::vector<SeqNo> &seqs,
+               std::vector<boost::tuple<bool/*inserted*/, bool/*updated*/, SeqNo/*oldSeqNo*/> > &results);
   
 private:
+  ObjectPoolPtr m_pool;
+  PoolAllocator<FullLeaf> m_allocator;
+  LeafContainer<FullLeaf> m_leaves;
   TimeType m_lastUpdated; ///< @brief Time when state was updated last time
-  DigestPtr m_digest;
+  DigestValue m_digest;
+
+  DigestMode m_digestMode;
+  DigestSum m_leavesSum; ///< @brief Sum of all leaf digests (maintained only in INCREMENTAL_DIGEST mode)
+  MerkleTree m_merkleTree; ///< @brief Merkle tree over all leaves (maintained only in MERKLE_DIGEST mode)
 };
 
+/**
+ * @brief Formats a protobuf SyncStateMsg msg
+ * @param oss output SyncStateMsg msg
+ * @param state state
+ * @returns output SyncStateMsg msg
+ */
+SyncStateMsg &
+operator << (SyncStateMsg &ossm, const FullState &state);
+
+/**
+ * @brief Encode full state for a Sync Data packet
+ * @param state state
+ * @param format wire format
+ * @param wireData output buffer (replaced)
+ */
+void
+encodeState (const FullState &state, WireFormat format, std::string &wireData);
+
 } // Sync
 
 #endif // SYNC_STATE_H
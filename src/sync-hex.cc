@@ -0,0 +1,256 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Zhenkai Zhu <zhenkai@cs.ucla.edu>
+ *         Chaoyi Bian <bcy@pku.edu.cn>
+ *	   Alexander Afanasyev <alexander.afanasyev@ucla.edu>
+ */
+
+#include "sync-hex.h"
+
+#if (defined (__x86_64__) || defined (__i386__)) && defined (__GNUC__)
+#define SYNC_HAVE_SIMD_HEX 1
+#include <immintrin.h>
+#endif
+
+namespace Sync {
+
+static const char HEX_DIGITS[] = "0123456789abcdef";
+
+static inline int
+hexValue (char ch)
+{
+  if (ch >= '0' && ch <= '9')
+    return ch - '0';
+  if (ch >= 'a' && ch <= 'f')
+    return ch - 'a' + 10;
+  if (ch >= 'A' && ch <= 'F')
+    return ch - 'A' + 10;
+  return -1;
+}
+
+static void
+hexEncodePortable (const uint8_t *data, size_t size, char *hex)
+{
+  for (size_t i = 0; i < size; i++)
+    {
+      hex[2*i]   = HEX_DIGITS[data[i] >> 4];
+      hex[2*i+1] = HEX_DIGITS[data[i] & 0x0f];
+    }
+}
+
+static bool
+hexDecodePortable (const char *hex, size_t length, uint8_t *data)
+{
+  for (size_t i = 0; i < length / 2; i++)
+    {
+      int high = hexValue (hex[2*i]);
+      int low  = hexValue (hex[2*i+1]);
+      if (high < 0 || low < 0)
+        return false;
+
+      data[i] = static_cast<uint8_t> ((high << 4) | low);
+    }
+  return true;
+}
+
+#ifdef SYNC_HAVE_SIMD_HEX
+
+// 16 bytes -> 32 characters
+__attribute__ ((target ("ssse3")))
+static void
+hexEncodeSsse3 (const uint8_t *data, size_t size, char *hex)
+{
+  const __m128i digits = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (HEX_DIGITS));
+  const __m128i mask = _mm_set1_epi8 (0x0f);
+
+  for (; size >= 16; size -= 16, data += 16, hex += 32)
+    {
+      __m128i in = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (data));
+      __m128i high = _mm_shuffle_epi8 (digits, _mm_and_si128 (_mm_srli_epi16 (in, 4), mask));
+      __m128i low  = _mm_shuffle_epi8 (digits, _mm_and_si128 (in, mask));
+
+      _mm_storeu_si128 (reinterpret_cast<__m128i*> (hex),      _mm_unpacklo_epi8 (high, low));
+      _mm_storeu_si128 (reinterpret_cast<__m128i*> (hex + 16), _mm_unpackhi_epi8 (high, low));
+    }
+
+  hexEncodePortable (data, size, hex);
+}
+
+// 32 bytes -> 64 characters
+__attribute__ ((target ("avx2")))
+static void
+hexEncodeAvx2 (const uint8_t *data, size_t size, char *hex)
+{
+  const __m256i digits = _mm256_broadcastsi128_si256 (_mm_loadu_si128 (reinterpret_cast<const __m128i*> (HEX_DIGITS)));
+  const __m256i mask = _mm256_set1_epi8 (0x0f);
+
+  for (; size >= 32; size -= 32, data += 32, hex += 64)
+    {
+      __m256i in = _mm256_loadu_si256 (reinterpret_cast<const __m256i*> (data));
+      __m256i high = _mm256_shuffle_epi8 (digits, _mm256_and_si256 (_mm256_srli_epi16 (in, 4), mask));
+      __m256i low  = _mm256_shuffle_epi8 (digits, _mm256_and_si256 (in, mask));
+
+      // unpack works within 128-bit lanes: [0-7 | 16-23] and [8-15 | 24-31]
+      __m256i first  = _mm256_unpacklo_epi8 (high, low);
+      __m256i second = _mm256_unpackhi_epi8 (high, low);
+
+      _mm256_storeu_si256 (reinterpret_cast<__m256i*> (hex),
+                           _mm256_permute2x128_si256 (first, second, 0x20));
+      _mm256_storeu_si256 (reinterpret_cast<__m256i*> (hex + 32),
+                           _mm256_permute2x128_si256 (first, second, 0x31));
+    }
+
+  hexEncodeSsse3 (data, size, hex);
+}
+
+// Convert 16 characters to nibble values; all bits of invalid are set for non-hex characters
+__attribute__ ((target ("ssse3")))
+static inline __m128i
+hexToNibblesSsse3 (__m128i ch, __m128i &invalid)
+{
+  __m128i lower = _mm_or_si128 (ch, _mm_set1_epi8 (0x20));
+
+  __m128i isDigit = _mm_and_si128 (_mm_cmpgt_epi8 (ch, _mm_set1_epi8 ('0' - 1)),
+                                   _mm_cmpgt_epi8 (_mm_set1_epi8 ('9' + 1), ch));
+  __m128i isLetter = _mm_and_si128 (_mm_cmpgt_epi8 (lower, _mm_set1_epi8 ('a' - 1)),
+                                    _mm_cmpgt_epi8 (_mm_set1_epi8 ('f' + 1), lower));
+
+  invalid = _mm_or_si128 (invalid, _mm_xor_si128 (_mm_or_si128 (isDigit, isLetter), _mm_set1_epi8 (-1)));
+
+  __m128i digit  = _mm_and_si128 (isDigit, _mm_sub_epi8 (ch, _mm_set1_epi8 ('0')));
+  __m128i letter = _mm_and_si128 (isLetter, _mm_sub_epi8 (lower, _mm_set1_epi8 ('a' - 10)));
+  return _mm_or_si128 (digit, letter);
+}
+
+// 32 characters -> 16 bytes
+__attribute__ ((target ("ssse3")))
+static bool
+hexDecodeSsse3 (const char *hex, size_t length, uint8_t *data)
+{
+  // high nibble (even position) * 16 + low nibble (odd position)
+  const __m128i weights = _mm_set1_epi16 (0x0110);
+  __m128i invalid = _mm_setzero_si128 ();
+
+  for (; length >= 32; length -= 32, hex += 32, data += 16)
+    {
+      __m128i first  = hexToNibblesSsse3 (_mm_loadu_si128 (reinterpret_cast<const __m128i*> (hex)), invalid);
+      __m128i second = hexToNibblesSsse3 (_mm_loadu_si128 (reinterpret_cast<const __m128i*> (hex + 16)), invalid);
+
+      __m128i bytes = _mm_packus_epi16 (_mm_maddubs_epi16 (first, weights),
+                                        _mm_maddubs_epi16 (second, weights));
+      _mm_storeu_si128 (reinterpret_cast<__m128i*> (data), bytes);
+    }
+
+  if (_mm_movemask_epi8 (invalid) != 0)
+    return false;
+
+  return hexDecodePortable (hex, length, data);
+}
+
+__attribute__ ((target ("avx2")))
+static inline __m256i
+hexToNibblesAvx2 (__m256i ch, __m256i &invalid)
+{
+  __m256i lower = _mm256_or_si256 (ch, _mm256_set1_epi8 (0x20));
+
+  __m256i isDigit = _mm256_and_si256 (_mm256_cmpgt_epi8 (ch, _mm256_set1_epi8 ('0' - 1)),
+                                      _mm256_cmpgt_epi8 (_mm256_set1_epi8 ('9' + 1), ch));
+  __m256i isLetter = _mm256_and_si256 (_mm256_cmpgt_epi8 (lower, _mm256_set1_epi8 ('a' - 1)),
+                                       _mm256_cmpgt_epi8 (_mm256_set1_epi8 ('f' + 1), lower));
+
+  invalid = _mm256_or_si256 (invalid, _mm256_xor_si256 (_mm256_or_si256 (isDigit, isLetter), _mm256_set1_epi8 (-1)));
+
+  __m256i digit  = _mm256_and_si256 (isDigit, _mm256_sub_epi8 (ch, _mm256_set1_epi8 ('0')));
+  __m256i letter = _mm256_and_si256 (isLetter, _mm256_sub_epi8 (lower, _mm256_set1_epi8 ('a' - 10)));
+  return _mm256_or_si256 (digit, letter);
+}
+
+// 64 characters -> 32 bytes
+__attribute__ ((target ("avx2")))
+static bool
+hexDecodeAvx2 (const char *hex, size_t length, uint8_t *data)
+{
+  const __m256i weights = _mm256_set1_epi16 (0x0110);
+  __m256i invalid = _mm256_setzero_si256 ();
+
+  for (; length >= 64; length -= 64, hex += 64, data += 32)
+    {
+      __m256i first  = hexToNibblesAvx2 (_mm256_loadu_si256 (reinterpret_cast<const __m256i*> (hex)), invalid);
+      __m256i second = hexToNibblesAvx2 (_mm256_loadu_si256 (reinterpret_cast<const __m256i*> (hex + 32)), invalid);
+
+      // pack works within 128-bit lanes, restore the order of 64-bit quarters
+      __m256i bytes = _mm256_packus_epi16 (_mm256_maddubs_epi16 (first, weights),
+                                           _mm256_maddubs_epi16 (second, weights));
+      _mm256_storeu_si256 (reinterpret_cast<__m256i*> (data), _mm256_permute4x64_epi64 (bytes, 0xD8));
+    }
+
+  if (_mm256_movemask_epi8 (invalid) != 0)
+    return false;
+
+  return hexDecodeSsse3 (hex, length, data);
+}
+
+#endif // SYNC_HAVE_SIMD_HEX
+
+typedef void (*HexEncodeFunction) (const uint8_t *data, size_t size, char *hex);
+typedef bool (*HexDecodeFunction) (const char *hex, size_t length, uint8_t *data);
+
+static HexEncodeFunction
+selectHexEncode ()
+{
+#ifdef SYNC_HAVE_SIMD_HEX
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("avx2"))
+    return &hexEncodeAvx2;
+  if (__builtin_cpu_supports ("ssse3"))
+    return &hexEncodeSsse3;
+#endif
+  return &hexEncodePortable;
+}
+
+static HexDecodeFunction
+selectHexDecode ()
+{
+#ifdef SYNC_HAVE_SIMD_HEX
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("avx2"))
+    return &hexDecodeAvx2;
+  if (__builtin_cpu_supports ("ssse3"))
+    return &hexDecodeSsse3;
+#endif
+  return &hexDecodePortable;
+}
+
+void
+hexEncode (const uint8_t *data, size_t size, char *hex)
+{
+  static HexEncodeFunction encode = selectHexEncode ();
+  encode (data, size, hex);
+}
+
+bool
+hexDecode (const char *hex, size_t length, uint8_t *data)
+{
+  if (length % 2 != 0)
+    return false;
+
+  static HexDecodeFunction decode = selectHexDecode ();
+  return decode (hex, length, data);
+}
+
+} // Sync
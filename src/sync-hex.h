@@ -20,14 +20,39 @@
  *	   Alexander Afanasyev <alexander.afanasyev@ucla.edu>
  */
 
-#include "sync-name-info.h"
+#ifndef SYNC_HEX_H
+#define SYNC_HEX_H
 
-// #include <boost/lexical_cast.hpp>
+#include <boost/cstdint.hpp>
+#include <cstddef>
 
 namespace Sync {
 
-NameInfo::NameMap NameInfo::m_names;
-size_t  NameInfo::m_ids = 0;
-boost::mutex NameInfo::m_namesMutex;
+/**
+ * @ingroup sync
+ * @brief Encode bytes as lower-case hex characters
+ * @param data bytes to encode
+ * @param size number of bytes
+ * @param hex output buffer of at least 2*size characters (not NUL-terminated)
+ *
+ * SSSE3 or AVX2 instructions are used if CPU supports them
+ */
+void
+hexEncode (const uint8_t *data, size_t size, char *hex);
+
+/**
+ * @ingroup sync
+ * @brief Decode hex characters (in either case) into bytes
+ * @param hex input characters
+ * @param length number of characters (should be even)
+ * @param data output buffer of at least length/2 bytes
+ * @returns false if length is odd or input contains non-hex characters
+ *
+ * SSSE3 or AVX2 instructions are used if CPU supports them
+ */
+bool
+hexDecode (const char *hex, size_t length, uint8_t *data);
 
 } // Sync
+
+#endif // SYNC_HEX_H
@@ -31,7 +31,6 @@
 // #include <boost/multi_index/composite_key.hpp>
 #include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/sequenced_index.hpp>
-#include <boost/multi_index/ordered_index.hpp>
 // #include <boost/multi_index/random_access_index.hpp>
 #include <boost/multi_index/member.hpp>
 #include <boost/multi_index/mem_fun.hpp>
@@ -42,7 +41,7 @@ namespace Sync {
 
 struct Interest
 {
-  Interest (DigestConstPtr digest, const std::string &name, bool unknown=false)
+  Interest (const DigestValue &digest, const std::string &name, bool unknown=false)
   : m_digest (digest)
   , m_name (name)
   , m_time (TIME_NOW)
@@ -50,7 +49,7 @@ struct Interest
   {
   }
   
-  DigestConstPtr m_digest;
+  DigestValue    m_digest;
   std::string    m_name;
   TimeAbsolute   m_time;
   bool           m_unknown;
@@ -59,7 +58,7 @@ struct Interest
 /// @cond include_hidden 
 struct named { };
 struct hashed;
-struct timed;
+struct timed { };
 /// @endcond
 
 /**
@@ -77,16 +76,13 @@ struct InterestContainer : public mi::multi_index_container<
     
     mi::hashed_non_unique<
       mi::tag<hashed>,
-      BOOST_MULTI_INDEX_MEMBER(Interest, DigestConstPtr, m_digest),
-      DigestPtrHash,
-      DigestPtrEqual
+      BOOST_MULTI_INDEX_MEMBER(Interest, DigestValue, m_digest)
       >
     ,
     
-    mi::ordered_non_unique<
-      mi::tag<timed>,
-      BOOST_MULTI_INDEX_MEMBER(Interest, TimeAbsolute, m_time)
-      >
+    // in order of insertion, which is also the order of expiration (all
+    // interests in the table have the same lifetime)
+    mi::sequenced<mi::tag<timed> >
     >
   >
 {
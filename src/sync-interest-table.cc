@@ -33,9 +33,6 @@ namespace Sync
 SyncInterestTable::SyncInterestTable (TimeDuration lifetime)
   : m_entryLifetime (lifetime)
 {
-  m_scheduler.schedule (TIME_SECONDS (m_checkPeriod),
-                        bind (&SyncInterestTable::expireInterests, this),
-                        0);
 }
 
 SyncInterestTable::~SyncInterestTable ()
@@ -45,7 +42,7 @@ SyncInterestTable::~SyncInterestTable ()
 Interest
 SyncInterestTable::pop ()
 {
-  recursive_mutex::scoped_lock lock (m_mutex);
+  Mutex::scoped_lock lock (m_mutex);
 
   if (m_table.size () == 0)
     BOOST_THROW_EXCEPTION (Error::InterestTableIsEmpty ());
@@ -56,12 +53,21 @@ SyncInterestTable::pop ()
   return ret;
 }
 
+void
+SyncInterestTable::popAll (std::vector<Interest> &interests)
+{
+  Mutex::scoped_lock lock (m_mutex);
+
+  interests.insert (interests.end (), m_table.begin (), m_table.end ());
+  m_table.clear ();
+}
+
 bool
-SyncInterestTable::insert (DigestConstPtr digest, const string &name, bool unknownState/*=false*/)
+SyncInterestTable::insert (const DigestValue &digest, const string &name, bool unknownState/*=false*/)
 {
   bool existent = false;
   
-  recursive_mutex::scoped_lock lock (m_mutex);
+  Mutex::scoped_lock lock (m_mutex);
   InterestContainer::index<named>::type::iterator it = m_table.get<named> ().find (name);
   if (it != m_table.end())
     {
@@ -70,20 +76,23 @@ SyncInterestTable::insert (DigestConstPtr digest, const string &name, bool unkno
     }
   m_table.insert (Interest (digest, name, unknownState));
 
+  if (m_table.size () == 1) // otherwise, expiration is already scheduled
+    scheduleExpiration ();
+
   return existent;
 }
 
 uint32_t
 SyncInterestTable::size () const
 {
-  recursive_mutex::scoped_lock lock (m_mutex);
+  Mutex::scoped_lock lock (m_mutex);
   return m_table.size ();
 }
 
 bool
 SyncInterestTable::remove (const string &name)
 {
-  recursive_mutex::scoped_lock lock (m_mutex);
+  Mutex::scoped_lock lock (m_mutex);
 
   InterestContainer::index<named>::type::iterator item = m_table.get<named> ().find (name);
   if (item != m_table.get<named> ().end ())
@@ -96,9 +105,9 @@ SyncInterestTable::remove (const string &name)
 }
 
 bool
-SyncInterestTable::remove (DigestConstPtr digest)
+SyncInterestTable::remove (const DigestValue &digest)
 {
-  recursive_mutex::scoped_lock lock (m_mutex);
+  Mutex::scoped_lock lock (m_mutex);
   InterestContainer::index<hashed>::type::iterator item = m_table.get<hashed> ().find (digest);
   if (item != m_table.get<hashed> ().end ())
     {
@@ -110,27 +119,33 @@ SyncInterestTable::remove (DigestConstPtr digest)
 
 void SyncInterestTable::expireInterests ()
 { 
-  recursive_mutex::scoped_lock lock (m_mutex);
+  Mutex::scoped_lock lock (m_mutex);
 
   uint32_t count = 0;
   TimeAbsolute expireTime = TIME_NOW - m_entryLifetime;
-  
-  while (m_table.size () > 0)
+
+  InterestContainer::index<timed>::type &byTime = m_table.get<timed> ();
+  while (byTime.size () > 0 && byTime.front ().m_time <= expireTime)
     {
-      InterestContainer::index<timed>::type::iterator item = m_table.get<timed> ().begin ();
-      
-      if (item->m_time < expireTime)
-        {
-          m_table.get<timed> ().erase (item);
-          count ++;
-        }
-      else
-        break;
-  }
+      byTime.pop_front ();
+      count ++;
+    }
 
   _LOG_DEBUG ("expireInterests (): expired " << count);
-  
-  m_scheduler.schedule (TIME_SECONDS (m_checkPeriod),
+
+  scheduleExpiration ();
+}
+
+void
+SyncInterestTable::scheduleExpiration ()
+{
+  m_scheduler.cancel (0);
+  if (m_table.size () == 0)
+    return;
+
+  // if the oldest interest has been removed meanwhile, the timer just fires earlier
+  TimeAbsolute expireTime = m_table.get<timed> ().front ().m_time + m_entryLifetime;
+  m_scheduler.schedule (expireTime - TIME_NOW,
                         bind (&SyncInterestTable::expireInterests, this),
                         0);
 }
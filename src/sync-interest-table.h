@@ -25,12 +25,12 @@
 
 #include <string>
 #include <vector>
-#include <boost/thread/recursive_mutex.hpp>
 #include <boost/thread/thread.hpp>
 #include <ctime>
 #include "sync-scheduler.h"
 #include "sync-digest.h"
 #include "sync-interest-container.h"
+#include "sync-threading-policy.h"
 
 namespace Sync {
 
@@ -52,13 +52,13 @@ public:
    * timestamp
    */
   bool
-  insert (DigestConstPtr interest, const std::string &name, bool unknownState=false);
+  insert (const DigestValue &interest, const std::string &name, bool unknownState=false);
 
   /**
    * @brief Remove interest by digest (e.g., when it was satisfied)
    */
   bool
-  remove (DigestConstPtr interest);
+  remove (const DigestValue &interest);
 
   /**
    * @brief Remove interest by name (e.g., when it was satisfied)
@@ -72,24 +72,36 @@ public:
   Interest
   pop ();
 
+  /**
+   * @brief pop all non-expired Interests from PIT
+   * @param interests vector to append Interests to
+   */
+  void
+  popAll (std::vector<Interest> &interests);
+
   uint32_t
   size () const;
 
 private:
   /**
-   * @brief periodically called to expire Interest
+   * @brief called when the oldest Interest expires
    */
   void
   expireInterests ();
 
-private:
-  static const int m_checkPeriod = 4; // seconds
+  /**
+   * @brief schedule expireInterests () at the expiration time of the oldest Interest
+   */
+  void
+  scheduleExpiration ();
 
+private:
   TimeDuration m_entryLifetime;
   InterestContainer m_table;
 
   Scheduler m_scheduler;
-  mutable boost::recursive_mutex m_mutex;
+  typedef ThreadingPolicy::RecursiveMutex Mutex;
+  mutable Mutex m_mutex;
 };
 
 namespace Error {
@@ -46,7 +46,7 @@ public:
   /**
    * @brief Get name of the leaf
    */
-  NameInfoConstPtr
+  const NameInfoConstPtr &
   getInfo () const { return m_info; }
 
   /**
@@ -30,6 +30,7 @@
 #include <boost/foreach.hpp>
 #include <boost/lexical_cast.hpp>
 #include <vector>
+#include <algorithm>
 
 using namespace std;
 using namespace boost;
@@ -52,16 +53,63 @@ INIT_LOGGER ("SyncLogic");
 namespace Sync
 {
 
+template<class StateType>
+static boost::shared_ptr<const string>
+encodeWireData (const StateType &state, WireFormat format)
+{
+  boost::shared_ptr<string> wireData = make_shared<string> ();
+  encodeState (state, format, *wireData);
+  return wireData;
+}
+
+/**
+ * @brief Leaves of received Sync Data, in the order of the packet
+ */
+class ReceivedLeaves : public StateVisitor
+{
+public:
+  virtual void
+  visitUpdate (const NameInfoConstPtr &info, const SeqNo &seq)
+  {
+    m_updateInfos.push_back (info);
+    m_updateSeqs.push_back (seq);
+  }
+
+  virtual void
+  visitRemove (const NameInfoConstPtr &info)
+  {
+    m_removeInfos.push_back (info);
+  }
+
+  std::vector<NameInfoConstPtr> m_updateInfos;
+  std::vector<SeqNo> m_updateSeqs;
+  std::vector<NameInfoConstPtr> m_removeInfos;
+};
+
+static bool
+isKnownStateInterest (const Interest &interest)
+{
+  return !interest.m_unknown;
+}
+
 SyncLogic::SyncLogic (const std::string &syncPrefix,
                       LogicUpdateCallback onUpdate,
                       LogicRemoveCallback onRemove)
-  : m_state (new FullState)
+  : m_pool (new ObjectPool)
+  , m_state (new FullState (FullState::ORDERED_DIGEST, m_pool))
+  , m_forwarderInfo (StdNameInfo::FindOrCreate (forwarderPrefix))
+  , m_wireFormat (PROTOBUF_WIRE_FORMAT)
+  , m_logMaxEntries (0)
+  , m_logMaxBytes (0)
+  , m_logStatistics ()
   , m_syncInterestTable (TIME_SECONDS (m_syncInterestReexpress))
   , m_syncPrefix (syncPrefix)
   , m_onUpdate (onUpdate)
   , m_onRemove (onRemove)
   , m_perBranch (false)
   , m_ccnxHandle(new CcnxWrapper ())
+  , m_publishCoalescingDelay (TIME_SECONDS (0))
+  , m_publishCoalescingMaxBatch (0)
   , m_recoveryRetransmissionInterval (m_defaultRecoveryRetransmitInterval)
   , m_rangeUniformRandom (200,1000)
   , m_reexpressionJitter (10,500)
@@ -70,12 +118,20 @@ SyncLogic::SyncLogic (const std::string &syncPrefix,
 
 SyncLogic::SyncLogic (const std::string &syncPrefix,
                       LogicPerBranchCallback onUpdateBranch)
-  : m_state (new FullState)
+  : m_pool (new ObjectPool)
+  , m_state (new FullState (FullState::ORDERED_DIGEST, m_pool))
+  , m_forwarderInfo (StdNameInfo::FindOrCreate (forwarderPrefix))
+  , m_wireFormat (PROTOBUF_WIRE_FORMAT)
+  , m_logMaxEntries (0)
+  , m_logMaxBytes (0)
+  , m_logStatistics ()
   , m_syncInterestTable (TIME_SECONDS (m_syncInterestReexpress))
   , m_syncPrefix (syncPrefix)
   , m_onUpdateBranch (onUpdateBranch)
   , m_perBranch(true)
   , m_ccnxHandle(new CcnxWrapper())
+  , m_publishCoalescingDelay (TIME_SECONDS (0))
+  , m_publishCoalescingMaxBatch (0)
   , m_recoveryRetransmissionInterval (m_defaultRecoveryRetransmitInterval)
   , m_rangeUniformRandom (200,1000)
   , m_reexpressionJitter (10,500)
@@ -83,7 +139,15 @@ SyncLogic::SyncLogic (const std::string &syncPrefix,
 }
 
 SyncLogic::SyncLogic ()
-: m_syncInterestTable (TIME_SECONDS (0))
+: m_pool (new ObjectPool)
+, m_forwarderInfo (StdNameInfo::FindOrCreate (forwarderPrefix))
+, m_wireFormat (PROTOBUF_WIRE_FORMAT)
+, m_logMaxEntries (0)
+, m_logMaxBytes (0)
+, m_logStatistics ()
+, m_syncInterestTable (TIME_SECONDS (0))
+, m_publishCoalescingDelay (TIME_SECONDS (0))
+, m_publishCoalescingMaxBatch (0)
 {
 }
 
@@ -120,18 +184,25 @@ SyncLogic::StartApplication ()
 void
 SyncLogic::StopApplication ()
 {
+  publishPendingLocalNames ();
+
   m_ccnxHandle->clearInterestFilter (m_syncPrefix);
   m_ccnxHandle->StopApplication ();
   m_scheduler.cancel (REEXPRESSING_INTEREST);
   m_scheduler.cancel (DELAYED_INTEREST_PROCESSING);
+  m_scheduler.cancel (PUBLISHING_LOCAL_NAMES);
 }
 
 void
 SyncLogic::stop()
 {
+  // local updates have already been accepted, so publish them (the same as StopApplication)
+  publishPendingLocalNames ();
+
   m_ccnxHandle->clearInterestFilter (m_syncPrefix);
   m_scheduler.cancel (REEXPRESSING_INTEREST);
   m_scheduler.cancel (DELAYED_INTEREST_PROCESSING);
+  m_scheduler.cancel (PUBLISHING_LOCAL_NAMES);
 }
 
 /**
@@ -140,28 +211,26 @@ SyncLogic::stop()
  * Normal name:    .../<hash>  
  * Recovery name:  .../recovery/<hash>
  */
-boost::tuple<DigestConstPtr, std::string>
+boost::tuple<DigestValue, std::string>
 SyncLogic::convertNameToDigestAndType (const std::string &name)
 {
   BOOST_ASSERT (name.find (m_syncPrefix) == 0);
 
-  string hash = name.substr (m_syncPrefix.size (), name.size ()-m_syncPrefix.size ());
-  if (hash[0] == '/')
-    hash = hash.substr (1, hash.size ()-1);
+  size_t hashStart = m_syncPrefix.size ();
+  if (hashStart < name.size () && name[hashStart] == '/')
+    hashStart ++;
   string interestType = "normal";
 
-  size_t pos = hash.find ('/');
+  size_t pos = name.find ('/', hashStart);
   if (pos != string::npos)
     {
-      interestType = hash.substr (0, pos);
-      hash         = hash.substr (pos + 1);
+      interestType.assign (name, hashStart, pos - hashStart);
+      hashStart = pos + 1;
     }
 
-  _LOG_TRACE (hash << ", " << interestType);
+  _LOG_TRACE (name.substr (hashStart) << ", " << interestType);
 
-  DigestPtr digest = make_shared<Digest> ();
-  istringstream is (hash);
-  is >> *digest;
+  DigestValue digest = DigestValue::fromHex (name.c_str () + hashStart, name.size () - hashStart);
 
   return boost::make_tuple (digest, interestType);
 }
@@ -173,7 +242,7 @@ SyncLogic::respondSyncInterest (const string &name)
     {
       _LOG_INFO ("<< I " << name);
 
-      DigestConstPtr digest;
+      DigestValue digest;
       string type;
       tie (digest, type) = convertNameToDigestAndType (name);
 
@@ -201,7 +270,7 @@ SyncLogic::respondSyncData (const std::string &name, const char *wireData, size_
     {
       _LOG_INFO ("<< D " << name);
   
-      DigestConstPtr digest;
+      DigestValue digest;
       string type;
       tie (digest, type) = convertNameToDigestAndType (name);
 
@@ -226,42 +295,50 @@ SyncLogic::respondSyncData (const std::string &name, const char *wireData, size_
 
 
 void
-SyncLogic::processSyncInterest (const std::string &name, DigestConstPtr digest, bool timedProcessing/*=false*/)
+SyncLogic::processSyncInterest (const std::string &name, const DigestValue &digest, bool timedProcessing/*=false*/)
 {
   _LOG_INFO ("Process Sync Interest: " << name);
-  DigestConstPtr rootDigest;
+  DigestValue rootDigest;
   {
-    recursive_mutex::scoped_lock lock (m_stateMutex);
+    Mutex::scoped_lock lock (m_stateMutex);
     rootDigest = m_state->getDigest();
   }
 
   // Special case when state is not empty and we have received request with zero-root digest
-  if (digest->isZero () && !rootDigest->isZero ())
+  if (digest.isZero () && !rootDigest.isZero ())
     {
-      
-      SyncStateMsg ssm;
+      WireDataPtr wireData;
       {
-        recursive_mutex::scoped_lock lock (m_stateMutex);
-        ssm << (*m_state);
+        Mutex::scoped_lock lock (m_stateMutex);
+        wireData = getFullStateWireData ();
       }
-      sendSyncData (name, digest, ssm);
+      sendSyncData (name, digest, *wireData);
       return;
     }
 
-  if (*rootDigest == *digest)
+  if (rootDigest == digest)
     {
       _LOG_INFO ("processSyncInterest (): Same state. Adding to PIT");
       m_syncInterestTable.insert (digest, name, false);
       return;
     }
   
-  DiffStateContainer::iterator stateInDiffLog = m_log.find (digest);
-
-  if (stateInDiffLog != m_log.end ())
+  WireDataPtr wireData;
   {
-    DiffStateConstPtr stateDiff = (*stateInDiffLog)->diff ();
+    Mutex::scoped_lock lock (m_stateMutex);
+    m_logStatistics.lookups ++;
+
+    uint64_t step = m_log.find (digest);
+    if (step != 0)
+      {
+        m_logStatistics.hits ++;
+        wireData = getDiffWireData (digest, step);
+      }
+  }
 
-    sendSyncData (name, digest, stateDiff);
+  if (wireData != 0)
+  {
+    sendSyncData (name, digest, *wireData);
     return;
   }
 
@@ -291,11 +368,11 @@ SyncLogic::processSyncInterest (const std::string &name, DigestConstPtr digest,
 }
 
 void
-SyncLogic::processSyncData (const std::string &name, DigestConstPtr digest, const char *wireData, size_t len)
+SyncLogic::processSyncData (const std::string &name, const DigestValue &digest, const char *wireData, size_t len)
 {
   _LOG_INFO("It is processSyncData");
   
-  DiffStatePtr diffLog = make_shared<DiffState> ();
+  DiffStatePtr diffLog = createDiffState ();
   bool ownInterestSatisfied = false;
   
   try
@@ -305,76 +382,66 @@ SyncLogic::processSyncData (const std::string &name, DigestConstPtr digest, cons
 
       ownInterestSatisfied = (name == m_outstandingInterestName);
 
-      DiffState diff;
-      SyncStateMsg msg;
-      if (!msg.ParseFromArray(wireData, len) || !msg.IsInitialized()) 
+      // decode in one pass, updates are collected to be applied in a batch, so leaf digests are calculated together
+      ReceivedLeaves received;
+      decodeState (wireData, len, received);
+
+      vector<boost::tuple<bool, bool, SeqNo> > updateResults;
       {
-        //Throw
-        BOOST_THROW_EXCEPTION (Error::SyncStateMsgDecodingFailure () );
+        Mutex::scoped_lock lock (m_stateMutex);
+        m_state->updateBatch (received.m_updateInfos, received.m_updateSeqs, updateResults);
       }
-      msg >> diff;
 
       vector<MissingDataInfo> v;
-      BOOST_FOREACH (LeafConstPtr leaf, diff.getLeaves().get<ordered>())
+      for (size_t i = 0; i < received.m_updateInfos.size (); i++)
         {
-          DiffLeafConstPtr diffLeaf = dynamic_pointer_cast<const DiffLeaf> (leaf);
-          BOOST_ASSERT (diffLeaf != 0);
+          const NameInfoConstPtr &info = received.m_updateInfos[i];
+          const SeqNo &seq = received.m_updateSeqs[i];
 
-          NameInfoConstPtr info = diffLeaf->getInfo();
-          if (diffLeaf->getOperation() == UPDATE)
-            {
-              SeqNo seq = diffLeaf->getSeq();
+          bool inserted = false;
+          bool updated = false;
+          SeqNo oldSeq;
+          tie (inserted, updated, oldSeq) = updateResults[i];
 
-              bool inserted = false;
-              bool updated = false;
-              SeqNo oldSeq;
+          if (inserted || updated)
+            {
+              diffLog->update (info, seq);
+              if (!oldSeq.isValid())
               {
-                recursive_mutex::scoped_lock lock (m_stateMutex);
-                tie (inserted, updated, oldSeq) = m_state->update (info, seq);
+                oldSeq = SeqNo(seq.getSession(), 0);
               }
-
-              if (inserted || updated)
+              else
+              {
+                ++oldSeq;
+              }
+              // there is no need for application to process update on forwarder node
+              if (info != m_forwarderInfo)
+              {
+                MissingDataInfo mdi = {info->toString(), oldSeq, seq};
+                if (m_perBranch)
                 {
-                  diffLog->update (info, seq);
-                  if (!oldSeq.isValid())
-                  {
-                    oldSeq = SeqNo(seq.getSession(), 0);
-                  }
-                  else
-                  {
-                    ++oldSeq;
-                  }
-                  // there is no need for application to process update on forwarder node
-                  if (info->toString() != forwarderPrefix)
-                  {
-                    MissingDataInfo mdi = {info->toString(), oldSeq, seq};
-                    if (m_perBranch)
-                    {
-                       ostringstream interestName;
-                       interestName << mdi.prefix << "/" << mdi.high.getSession() << "/" << mdi.high.getSeq();
-                       m_onUpdateBranch(interestName.str());
-                    }
-                    else
-                    {
-                      v.push_back(mdi);
-                    }
-                  }
+                   ostringstream interestName;
+                   interestName << mdi.prefix << "/" << mdi.high.getSession() << "/" << mdi.high.getSeq();
+                   m_onUpdateBranch(interestName.str());
                 }
-            }
-          else if (diffLeaf->getOperation() == REMOVE)
-            {
-              recursive_mutex::scoped_lock lock (m_stateMutex);
-              if (m_state->remove (info))
+                else
                 {
-                  diffLog->remove (info);
-                  if (!m_perBranch)
-                  {
-                    m_onRemove (info->toString ());
-                  }
+                  v.push_back(mdi);
                 }
+              }
             }
-          else
+        }
+
+      BOOST_FOREACH (const NameInfoConstPtr &info, received.m_removeInfos)
+        {
+          Mutex::scoped_lock lock (m_stateMutex);
+          if (m_state->remove (info))
             {
+              diffLog->remove (info);
+              if (!m_perBranch)
+              {
+                m_onRemove (info->toString ());
+              }
             }
         }
 
@@ -413,95 +480,190 @@ SyncLogic::processSyncData (const std::string &name, DigestConstPtr digest, cons
 }
 
 void
-SyncLogic::processSyncRecoveryInterest (const std::string &name, DigestConstPtr digest)
+SyncLogic::processSyncRecoveryInterest (const std::string &name, const DigestValue &digest)
 {
-  
-  DiffStateContainer::iterator stateInDiffLog = m_log.find (digest);
-
-  if (stateInDiffLog == m_log.end ())
-    {
-      _LOG_INFO ("Could not find " << *digest << " in digest log");
-      return;
-    }
-
-  SyncStateMsg ssm;
+  WireDataPtr wireData;
   {
-    recursive_mutex::scoped_lock lock (m_stateMutex);
-    ssm << (*m_state);
+    Mutex::scoped_lock lock (m_stateMutex);
+    if (m_log.find (digest) == 0)
+      {
+        _LOG_INFO ("Could not find " << digest << " in digest log");
+        return;
+      }
+
+    wireData = getFullStateWireData ();
   }
-  sendSyncData (name, digest, ssm);
+  sendSyncData (name, digest, *wireData);
 }
 
 void
 SyncLogic::satisfyPendingSyncInterests (DiffStateConstPtr diffLog)
 {
-  DiffStatePtr fullStateLog = make_shared<DiffState> ();
-  {
-    recursive_mutex::scoped_lock lock (m_stateMutex);
-    BOOST_FOREACH (LeafConstPtr leaf, m_state->getLeaves ()/*.get<timed> ()*/)
-      {
-        fullStateLog->update (leaf->getInfo (), leaf->getSeq ());
-        /// @todo Impose limit on how many state info should be send out
-      }
-  }
-  
-  try
+  vector<Interest> interests;
+  m_syncInterestTable.popAll (interests);
+  if (interests.empty ())
+    return;
+
+  // group interests by the reply they need, so every reply is built and encoded only once
+  vector<Interest>::iterator unknown = std::partition (interests.begin (), interests.end (), isKnownStateInterest);
+
+  if (unknown != interests.begin ())
     {
-      uint32_t counter = 0;
-      while (m_syncInterestTable.size () > 0)
-        {
-          Interest interest = m_syncInterestTable.pop ();
+      WireDataPtr diffWireData = encodeWireData (*diffLog, m_wireFormat);
 
-          if (!interest.m_unknown)
-            {
-              _LOG_INFO (">> D " << interest.m_name);
-              sendSyncData (interest.m_name, interest.m_digest, diffLog);
-            }
-          else
-            {
-              _LOG_INFO (">> D (unknown)" << interest.m_name);
-              sendSyncData (interest.m_name, interest.m_digest, fullStateLog);
-            }
-          counter ++;
+      for (vector<Interest>::iterator interest = interests.begin (); interest != unknown; interest++)
+        {
+          _LOG_INFO (">> D " << interest->m_name);
+          sendSyncData (interest->m_name, interest->m_digest, *diffWireData);
         }
-      _LOG_DEBUG ("Satisfied " << counter << " pending interests");
     }
-  catch (Error::InterestTableIsEmpty &e)
+
+  if (unknown != interests.end ())
     {
-      // ok. not really an error
+      WireDataPtr fullStateWireData;
+      {
+        /// @todo Impose limit on how many state info should be send out
+        Mutex::scoped_lock lock (m_stateMutex);
+        fullStateWireData = getFullStateWireData ();
+      }
+
+      for (vector<Interest>::iterator interest = unknown; interest != interests.end (); interest++)
+        {
+          _LOG_INFO (">> D (unknown)" << interest->m_name);
+          sendSyncData (interest->m_name, interest->m_digest, *fullStateWireData);
+        }
     }
+
+  _LOG_DEBUG ("Satisfied " << interests.size () << " pending interests");
+}
+
+void
+SyncLogic::setPublishCoalescing (const TimeDuration &delay, size_t maxBatch)
+{
+  {
+    Mutex::scoped_lock lock (m_stateMutex);
+    m_publishCoalescingDelay = delay;
+    m_publishCoalescingMaxBatch = maxBatch;
+  }
+
+  if (!(delay > TIME_SECONDS (0)))
+    publishPendingLocalNames ();
+}
+
+void
+SyncLogic::publishPendingLocalNames ()
+{
+  vector<LocalNameUpdate> updates;
+  {
+    Mutex::scoped_lock lock (m_stateMutex);
+    if (m_pendingLocalNames.empty ())
+      return;
+
+    updates.swap (m_pendingLocalNames);
+    m_scheduler.cancel (PUBLISHING_LOCAL_NAMES);
+  }
+
+  _LOG_DEBUG ("Publishing " << updates.size () << " coalesced local updates");
+  addLocalNamesBatch (updates);
+}
+
+DiffStatePtr
+SyncLogic::createDiffState ()
+{
+  return allocate_shared<DiffState> (PoolAllocator<DiffState> (m_pool), m_pool);
 }
 
 void
 SyncLogic::insertToDiffLog (DiffStatePtr diffLog) 
 {
+  // callers usually hold the lock already (the mutex is recursive), but processSyncData does not
+  Mutex::scoped_lock lock (m_stateMutex);
+
   diffLog->setDigest (m_state->getDigest());  
-  if (m_log.size () > 0)
+  uint64_t step = m_log.push (m_state->getDigest ());
+  m_logChanges.record (*diffLog, step);
+
+  // changes at or before the oldest step are never collected
+  m_logChanges.prune (m_log.getFirstStep ());
+
+  // evict the oldest diffs
+  while (m_log.size () > 1 &&
+         ((m_logMaxEntries > 0 && m_log.size () > m_logMaxEntries) ||
+          (m_logMaxBytes > 0 && getDiffLogMemoryUsage () > m_logMaxBytes)))
     {
-      m_log.get<sequenced> ().front ()->setNext (diffLog);
+      m_log.pop ();
+      m_logChanges.prune (m_log.getFirstStep ());
+      m_logStatistics.evictions ++;
     }
-  m_log.erase (m_state->getDigest()); // remove diff state with the same digest.  next pointers are still valid
-  /// @todo Optimization
-  m_log.get<sequenced> ().push_front (diffLog);
+}
+
+size_t
+SyncLogic::getDiffLogMemoryUsage () const
+{
+  return m_log.getMemoryUsage () + m_logChanges.getMemoryUsage ();
+}
+
+void
+SyncLogic::setDiffLogLimits (size_t maxEntries, size_t maxBytes)
+{
+  Mutex::scoped_lock lock (m_stateMutex);
+  m_logMaxEntries = maxEntries;
+  m_logMaxBytes = maxBytes;
+}
+
+DiffLogStatistics
+SyncLogic::getDiffLogStatistics () const
+{
+  Mutex::scoped_lock lock (m_stateMutex);
+  DiffLogStatistics statistics = m_logStatistics;
+  statistics.entries = m_log.size ();
+  statistics.bytes = getDiffLogMemoryUsage ();
+  return statistics;
 }
 
 void
 SyncLogic::addLocalNames (const string &prefix, uint32_t session, uint32_t seq)
 {
+  bool coalesced = false;
+  {
+    Mutex::scoped_lock lock (m_stateMutex);
+    if (m_publishCoalescingDelay > TIME_SECONDS (0))
+      {
+        LocalNameUpdate update = { prefix, session, seq };
+        m_pendingLocalNames.push_back (update);
+
+        if (m_pendingLocalNames.size () == 1)
+          m_scheduler.schedule (m_publishCoalescingDelay,
+                                bind (&SyncLogic::publishPendingLocalNames, this),
+                                PUBLISHING_LOCAL_NAMES);
+
+        if (m_publishCoalescingMaxBatch == 0 ||
+            m_pendingLocalNames.size () < m_publishCoalescingMaxBatch)
+          return; // will be published when coalescing window expires
+
+        coalesced = true;
+      }
+  }
+  if (coalesced)
+    {
+      publishPendingLocalNames ();
+      return;
+    }
+
   DiffStatePtr diff;
   {
     //cout << "Add local names" <<endl;
-    recursive_mutex::scoped_lock lock (m_stateMutex);
+    Mutex::scoped_lock lock (m_stateMutex);
     NameInfoConstPtr info = StdNameInfo::FindOrCreate(prefix);
 
-    _LOG_INFO ("addLocalNames (): old state " << *m_state->getDigest ());
+    _LOG_INFO ("addLocalNames (): old state " << m_state->getDigest ());
 
     SeqNo seqN (session, seq);
     m_state->update(info, seqN);
 
-    _LOG_INFO ("addLocalNames (): new state " << *m_state->getDigest ());
+    _LOG_INFO ("addLocalNames (): new state " << m_state->getDigest ());
     
-    diff = make_shared<DiffState>();
+    diff = createDiffState ();
     diff->update(info, seqN);
     insertToDiffLog (diff);
   }
@@ -510,30 +672,75 @@ SyncLogic::addLocalNames (const string &prefix, uint32_t session, uint32_t seq)
   satisfyPendingSyncInterests (diff);  
 }
 
+void
+SyncLogic::addLocalNamesBatch (const vector<LocalNameUpdate> &updates)
+{
+  if (updates.empty ())
+    return;
+
+  vector<NameInfoConstPtr> infos;
+  vector<SeqNo> seqs;
+  infos.reserve (updates.size ());
+  seqs.reserve (updates.size ());
+  BOOST_FOREACH (const LocalNameUpdate &update, updates)
+    {
+      infos.push_back (StdNameInfo::FindOrCreate (update.prefix));
+      seqs.push_back (SeqNo (update.session, update.seq));
+    }
+
+  DiffStatePtr diff;
+  {
+    Mutex::scoped_lock lock (m_stateMutex);
+
+    _LOG_INFO ("addLocalNamesBatch (): old state " << m_state->getDigest ());
+
+    vector<boost::tuple<bool, bool, SeqNo> > results;
+    m_state->updateBatch (infos, seqs, results);
+
+    _LOG_INFO ("addLocalNamesBatch (): new state " << m_state->getDigest ());
+
+    // only changed names go to the diff (for repeated names, the largest sequence number wins)
+    diff = createDiffState ();
+    for (size_t i = 0; i < infos.size (); i++)
+      {
+        if (results[i].get<0> () || results[i].get<1> ())
+          diff->update (infos[i], seqs[i]);
+      }
+
+    if (diff->getLeaves ().empty ())
+      return;
+
+    insertToDiffLog (diff);
+  }
+
+  satisfyPendingSyncInterests (diff);
+}
+
 void
 SyncLogic::remove(const string &prefix) 
 {
+  // pending updates should not resurrect the prefix after removal
+  publishPendingLocalNames ();
+
   DiffStatePtr diff;
   {
-    recursive_mutex::scoped_lock lock (m_stateMutex);
+    Mutex::scoped_lock lock (m_stateMutex);
     NameInfoConstPtr info = StdNameInfo::FindOrCreate(prefix);
     m_state->remove(info);	
 
     // increment the sequence number for the forwarder node
-    NameInfoConstPtr forwarderInfo = StdNameInfo::FindOrCreate(forwarderPrefix);
-
-    LeafContainer::iterator item = m_state->getLeaves ().find (forwarderInfo);
+    LeafContainer<FullLeaf>::iterator item = m_state->getLeaves ().find (m_forwarderInfo);
     SeqNo seqNo (0);
     if (item != m_state->getLeaves ().end ())
       {
         seqNo = (*item)->getSeq ();
         ++seqNo;
       }
-    m_state->update (forwarderInfo, seqNo);
+    m_state->update (m_forwarderInfo, seqNo);
 
-    diff = make_shared<DiffState>();
+    diff = createDiffState ();
     diff->remove(info);
-    diff->update(forwarderInfo, seqNo);
+    diff->update(m_forwarderInfo, seqNo);
 
     insertToDiffLog (diff);
   }
@@ -541,17 +748,100 @@ SyncLogic::remove(const string &prefix)
   satisfyPendingSyncInterests (diff);  
 }
 
+void
+SyncLogic::setDigestMode (FullState::DigestMode mode)
+{
+  Mutex::scoped_lock lock (m_stateMutex);
+  if (m_state->getDigestMode () == mode)
+    return;
+
+  m_state->setDigestMode (mode);
+
+  // root digest has changed, digests in the log and cached replies are from the old mode
+  m_log = DiffHistory ();
+  m_logChanges = ChangeIndex ();
+  m_wireCacheDigest = DigestValue ();
+  m_fullStateWireData.reset ();
+  m_diffWireData.clear ();
+}
+
+void
+SyncLogic::setWireFormat (WireFormat format)
+{
+  Mutex::scoped_lock lock (m_stateMutex);
+  m_wireFormat = format;
+
+  // drop replies encoded in the old format
+  m_wireCacheDigest = DigestValue ();
+  m_fullStateWireData.reset ();
+  m_diffWireData.clear ();
+}
+
+void
+SyncLogic::validateWireCache ()
+{
+  const DigestValue &rootDigest = m_state->getDigest ();
+  if (m_wireCacheDigest.empty () || m_wireCacheDigest != rootDigest)
+    {
+      m_wireCacheDigest = rootDigest;
+      m_fullStateWireData.reset ();
+      m_diffWireData.clear ();
+    }
+}
+
+SyncLogic::WireDataPtr
+SyncLogic::getFullStateWireData ()
+{
+  validateWireCache ();
+  if (m_fullStateWireData == 0)
+    {
+      m_fullStateWireData = encodeWireData (*m_state, m_wireFormat);
+    }
+  return m_fullStateWireData;
+}
+
+SyncLogic::WireDataPtr
+SyncLogic::getDiffWireData (const DigestValue &digest, uint64_t step)
+{
+  validateWireCache ();
+  for (size_t i = 0; i < m_diffWireData.size (); i++)
+    {
+      if (m_diffWireData[i].first == digest)
+        return m_diffWireData[i].second;
+    }
+
+  // the same as diff () of the diff state with the digest, but does not depend on how old the digest is
+  DiffStatePtr diff = createDiffState ();
+  m_logChanges.collect (step, *diff);
+
+  WireDataPtr wireData = encodeWireData (*diff, m_wireFormat);
+
+  if (m_diffWireData.size () >= m_maxDiffWireData)
+    m_diffWireData.erase (m_diffWireData.begin ());
+  m_diffWireData.push_back (make_pair (digest, wireData));
+
+  return wireData;
+}
+
+ObjectPool::Statistics
+SyncLogic::getAllocationStatistics () const
+{
+  return m_pool->getStatistics ();
+}
+
 void
 SyncLogic::sendSyncInterest ()
 {
-  ostringstream os;
+  string interestName;
 
   {
-    recursive_mutex::scoped_lock lock (m_stateMutex);
+    Mutex::scoped_lock lock (m_stateMutex);
 
-    os << m_syncPrefix << "/" << *m_state->getDigest();
-    m_outstandingInterestName = os.str ();
-    _LOG_INFO (">> I " << os.str ());
+    interestName.reserve (m_syncPrefix.size () + 1 + 2 * DigestValue::MAX_SIZE);
+    interestName.append (m_syncPrefix).append (1, '/');
+    m_state->getDigest ().appendHex (interestName);
+    m_outstandingInterestName = interestName;
+    _LOG_INFO (">> I " << interestName);
   }
 
   m_scheduler.cancel (REEXPRESSING_INTEREST);
@@ -559,16 +849,18 @@ SyncLogic::sendSyncInterest ()
                         bind (&SyncLogic::sendSyncInterest, this),
                         REEXPRESSING_INTEREST);
   
-  m_ccnxHandle->sendInterest (os.str (),
+  m_ccnxHandle->sendInterest (interestName,
                               bind (&SyncLogic::respondSyncData, this, _1, _2, _3));
 }
 
 void
-SyncLogic::sendSyncRecoveryInterests (DigestConstPtr digest)
+SyncLogic::sendSyncRecoveryInterests (const DigestValue &digest)
 {
-  ostringstream os;
-  os << m_syncPrefix << "/recovery/" << *digest;
-  _LOG_INFO (">> I " << os.str ());
+  string interestName;
+  interestName.reserve (m_syncPrefix.size () + 10 + 2 * DigestValue::MAX_SIZE);
+  interestName.append (m_syncPrefix).append ("/recovery/");
+  digest.appendHex (interestName);
+  _LOG_INFO (">> I " << interestName);
 
   TimeDuration nextRetransmission = TIME_MILLISECONDS_WITH_JITTER (m_recoveryRetransmissionInterval);
   m_recoveryRetransmissionInterval <<= 1;
@@ -581,38 +873,26 @@ SyncLogic::sendSyncRecoveryInterests (DigestConstPtr digest)
                             REEXPRESSING_RECOVERY_INTEREST);
     }
 
-  m_ccnxHandle->sendInterest (os.str (),
+  m_ccnxHandle->sendInterest (interestName,
                               bind (&SyncLogic::respondSyncData, this, _1, _2, _3));
 }
 
 
-void
-SyncLogic::sendSyncData (const std::string &name, DigestConstPtr digest, StateConstPtr state)
-{
-  SyncStateMsg msg;
-  msg << (*state);
-  sendSyncData(name, digest, msg);
-}
-
-// pass in state msg instead of state, so that there is no need to lock the state until
+// pass in encoded state instead of state, so that there is no need to lock the state until
 // this function returns
 void
-SyncLogic::sendSyncData (const std::string &name, DigestConstPtr digest, SyncStateMsg &ssm)
+SyncLogic::sendSyncData (const std::string &name, const DigestValue &digest, const std::string &wireData)
 {
   _LOG_INFO (">> D " << name);
-  int size = ssm.ByteSize();
-  char *wireData = new char[size];
-  ssm.SerializeToArray(wireData, size);
   m_ccnxHandle->publishRawData (name,
-                             wireData,
-                             size,
+                             wireData.c_str (),
+                             wireData.size (),
                              m_syncResponseFreshness); // in NS-3 it doesn't have any effect... yet
-  delete []wireData;
 
   // checking if our own interest got satisfied
   bool satisfiedOwnInterest = false;
   {
-    recursive_mutex::scoped_lock lock (m_stateMutex);
+    Mutex::scoped_lock lock (m_stateMutex);
     satisfiedOwnInterest = (m_outstandingInterestName == name);
   }
   
@@ -630,25 +910,25 @@ SyncLogic::sendSyncData (const std::string &name, DigestConstPtr digest, SyncSta
 string
 SyncLogic::getRootDigest() 
 {
-  ostringstream os;
-  recursive_mutex::scoped_lock lock (m_stateMutex);
-  os << *m_state->getDigest();
-  return os.str();
+  string digest;
+  Mutex::scoped_lock lock (m_stateMutex);
+  m_state->getDigest ().appendHex (digest);
+  return digest;
 }
 
 size_t
 SyncLogic::getNumberOfBranches () const
 {
-  recursive_mutex::scoped_lock lock (m_stateMutex);
+  Mutex::scoped_lock lock (m_stateMutex);
   return m_state->getLeaves ().size ();
 }
 
 void
 SyncLogic::printState () const
 {
-  recursive_mutex::scoped_lock lock (m_stateMutex);
+  Mutex::scoped_lock lock (m_stateMutex);
 
-  BOOST_FOREACH (const boost::shared_ptr<Sync::Leaf> leaf, m_state->getLeaves ())
+  BOOST_FOREACH (const FullLeafPtr &leaf, m_state->getLeaves ())
     {
       std::cout << *leaf << std::endl;
     }
@@ -657,17 +937,16 @@ SyncLogic::printState () const
 std::map<std::string, bool>
 SyncLogic::getBranchPrefixes() const
 {
-  recursive_mutex::scoped_lock lock (m_stateMutex);
+  Mutex::scoped_lock lock (m_stateMutex);
 
   std::map<std::string, bool> m;
 
-  BOOST_FOREACH (const boost::shared_ptr<Sync::Leaf> leaf, m_state->getLeaves ())
+  BOOST_FOREACH (const FullLeafPtr &leaf, m_state->getLeaves ())
     {
-      std::string prefix = leaf->getInfo()->toString();
       // do not return forwarder prefix
-      if (prefix != forwarderPrefix)
+      if (leaf->getInfo() != m_forwarderInfo)
       {
-        m.insert(pair<std::string, bool>(prefix, false));
+        m.insert(pair<std::string, bool>(leaf->getInfo()->toString(), false));
       }
     }
 
@@ -24,7 +24,6 @@
 #define SYNC_LOGIC_H
 
 #include <boost/shared_ptr.hpp>
-#include <boost/thread/recursive_mutex.hpp>
 #include <boost/random.hpp>
 #include <memory>
 #include <map>
@@ -35,7 +34,9 @@
 #include "sync-full-state.h"
 #include "sync-std-name-info.h"
 #include "sync-scheduler.h"
-#include "sync-diff-state-container.h"
+#include "sync-diff-history.h"
+#include "sync-change-index.h"
+#include "sync-threading-policy.h"
 
 #include <ns3/application.h>
 #include <ns3/random-variable.h>
@@ -54,6 +55,20 @@ struct MissingDataInfo {
   SeqNo high;
 };
 
+struct DiffLogStatistics {
+  size_t lookups;   ///< @brief number of lookups of unknown (not equal to the current root) digests
+  size_t hits;      ///< @brief number of lookups that found the digest in the log (can be answered with diff)
+  size_t evictions; ///< @brief number of diffs evicted from the log because of the limits
+  size_t entries;   ///< @brief current number of diffs in the log
+  size_t bytes;     ///< @brief current approximate memory usage of the log (digests and the index of changes)
+};
+
+struct LocalNameUpdate {
+  std::string prefix;
+  uint32_t session;
+  uint32_t seq;
+};
+
 /**
  * \ingroup sync
  * @brief A wrapper for SyncApp, which handles ccnx related things (process
@@ -94,6 +109,42 @@ public:
    */
   void addLocalNames (const std::string &prefix, uint32_t session, uint32_t seq);
 
+  /**
+   * @brief the same as calling addLocalNames for every element, but the state is
+   * updated under one lock and only one diff is created and sent out
+   * @param updates new sequence numbers of local prefixes
+   */
+  void addLocalNamesBatch (const std::vector<LocalNameUpdate> &updates);
+
+  /**
+   * @brief accumulate local updates (addLocalNames) and publish them as one diff
+   * @param delay maximum time the first accumulated update waits to be published
+   * (zero disables coalescing, which is the default)
+   * @param maxBatch number of accumulated updates, at which they are published
+   * without waiting for the delay to expire (zero for no limit)
+   *
+   * Under high update rate, this trades a bounded publishing latency for much
+   * smaller number of root digest changes, Sync Data packets and re-expressed
+   * Sync Interests
+   */
+  void setPublishCoalescing (const TimeDuration &delay, size_t maxBatch);
+
+  /**
+   * @brief limit size of the log of diffs (oldest diffs are evicted first)
+   * @param maxEntries maximum number of diffs (zero for no limit)
+   * @param maxBytes maximum approximate memory usage of the log (zero for no limit)
+   *
+   * Interests with digests that are not in the log cannot be answered with a
+   * diff and will go through the recovery.  Use getDiffLogStatistics () to
+   * find the limits that give the desired hit rate
+   */
+  void setDiffLogLimits (size_t maxEntries, size_t maxBytes);
+
+  /**
+   * @brief get counters of the log of diffs
+   */
+  DiffLogStatistics getDiffLogStatistics () const;
+
   /**
    * @brief respond to the Sync Interest; a lot of logic needs to go in here
    * @param interest the Sync Interest in string format
@@ -113,6 +164,29 @@ public:
    */
   void remove (const std::string &prefix);
 
+  /**
+   * @brief select method to calculate the root digest of the sync tree
+   * @param mode digest calculation method (all participants of the sync group must use the same one)
+   *
+   * Changing the mode clears the log of diffs, so interests with digests
+   * calculated in the old mode are answered with the full state
+   */
+  void setDigestMode (FullState::DigestMode mode);
+
+  /**
+   * @brief select encoding of the state in Sync Data packets sent by this instance
+   * @param format wire format (PROTOBUF_WIRE_FORMAT by default)
+   *
+   * Received packets are decoded in any format, so instances with different
+   * settings can be mixed, as long as all of them understand the formats used
+   */
+  void setWireFormat (WireFormat format);
+
+  /**
+   * @brief get counters of the pool, from which state leaves and diffs are allocated
+   */
+  ObjectPool::Statistics getAllocationStatistics () const;
+
 
 #ifdef _DEBUG
   Scheduler &
@@ -137,46 +211,76 @@ private:
 
   void
   processSyncInterest (const std::string &name,
-                       DigestConstPtr digest, bool timedProcessing=false);
+                       const DigestValue &digest, bool timedProcessing=false);
 
   void
   processSyncData (const std::string &name,
-                   DigestConstPtr digest, const char *wireData, size_t len);
+                   const DigestValue &digest, const char *wireData, size_t len);
   
   void
   processSyncRecoveryInterest (const std::string &name,
-                               DigestConstPtr digest);
+                               const DigestValue &digest);
   
+  DiffStatePtr
+  createDiffState ();
+
+  void
+  publishPendingLocalNames ();
+
   void 
   insertToDiffLog (DiffStatePtr diff);
 
+  size_t
+  getDiffLogMemoryUsage () const;
+
   void
   satisfyPendingSyncInterests (DiffStateConstPtr diff);
 
-  boost::tuple<DigestConstPtr, std::string>
+  boost::tuple<DigestValue, std::string>
   convertNameToDigestAndType (const std::string &name);
 
   void
   sendSyncInterest ();
 
   void
-  sendSyncRecoveryInterests (DigestConstPtr digest);
+  sendSyncRecoveryInterests (const DigestValue &digest);
 
   void
   sendSyncData (const std::string &name,
-                DigestConstPtr digest, StateConstPtr state);
+                const DigestValue &digest, const std::string &wireData);
+
+  typedef boost::shared_ptr<const std::string> WireDataPtr;
 
   void
-  sendSyncData (const std::string &name,
-                DigestConstPtr digest, SyncStateMsg &msg);
+  validateWireCache ();
+
+  WireDataPtr
+  getFullStateWireData ();
+
+  WireDataPtr
+  getDiffWireData (const DigestValue &digest, uint64_t step);
 
   size_t
   getNumberOfBranches () const;
   
 private:
+  ObjectPoolPtr m_pool; ///< @brief pool for leaves and diffs (must be declared before, so it is destroyed after, all of the states)
   FullStatePtr m_state;
-  DiffStateContainer m_log;
-  mutable boost::recursive_mutex m_stateMutex;
+  NameInfoConstPtr m_forwarderInfo; ///< @brief interned forwarderPrefix (names are compared by pointer)
+  DiffHistory m_log;
+  ChangeIndex m_logChanges; ///< @brief the latest change of every name in the log (used to answer with accumulated diff)
+
+  // serialized replies, valid only while root digest is m_wireCacheDigest (guarded by m_stateMutex)
+  DigestValue m_wireCacheDigest;
+  WireDataPtr m_fullStateWireData; ///< @brief full state (reply to zero-digest and recovery interests)
+  std::vector<std::pair<DigestValue, WireDataPtr> > m_diffWireData; ///< @brief diffs from requested digests
+  static const size_t m_maxDiffWireData = 16;
+  WireFormat m_wireFormat;
+  size_t m_logMaxEntries;
+  size_t m_logMaxBytes;
+  DiffLogStatistics m_logStatistics;
+  typedef ThreadingPolicy::RecursiveMutex Mutex;
+  mutable Mutex m_stateMutex;
 
   std::string m_outstandingInterestName;
   SyncInterestTable m_syncInterestTable;
@@ -190,6 +294,10 @@ private:
 
   Scheduler m_scheduler;
 
+  TimeDuration m_publishCoalescingDelay;
+  size_t m_publishCoalescingMaxBatch;
+  std::vector<LocalNameUpdate> m_pendingLocalNames; ///< @brief local updates accumulated during coalescing window (guarded by m_stateMutex)
+
   static const int m_defaultRecoveryRetransmitInterval = 200; // milliseconds
   uint32_t m_recoveryRetransmissionInterval; // milliseconds
   
@@ -204,7 +312,8 @@ private:
     {
       DELAYED_INTEREST_PROCESSING = 1,
       REEXPRESSING_INTEREST = 2,
-      REEXPRESSING_RECOVERY_INTEREST = 3
+      REEXPRESSING_RECOVERY_INTEREST = 3,
+      PUBLISHING_LOCAL_NAMES = 4
     };
 };
 
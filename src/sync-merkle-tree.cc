@@ -0,0 +1,252 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Zhenkai Zhu <zhenkai@cs.ucla.edu>
+ *         Chaoyi Bian <bcy@pku.edu.cn>
+ *	   Alexander Afanasyev <alexander.afanasyev@ucla.edu>
+ */
+
+#include "sync-merkle-tree.h"
+#include "sync-full-leaf.h"
+
+#include <boost/assert.hpp>
+#include <string.h>
+
+namespace Sync {
+
+/**
+ * @brief Treap priority from the name digest
+ *
+ * Bytes are read in explicit (big-endian) order into a fixed-width value, so the
+ * tree shape, and thus the root digest, is the same on all platforms
+ */
+static uint64_t
+priorityOf (const DigestValue &digest)
+{
+  BOOST_ASSERT (digest.size () >= sizeof (uint64_t));
+
+  uint64_t priority = 0;
+  for (size_t i = 0; i < sizeof (uint64_t); i++)
+    priority = (priority << 8) | digest.data ()[i];
+  return priority;
+}
+
+MerkleTree::Node::Node (NameInfoConstPtr info, const FullLeaf *leaf)
+  : m_info (info)
+  , m_leaf (leaf)
+  , m_priority (priorityOf (info->getDigest ()))
+  , m_left (0)
+  , m_right (0)
+  , m_size (1)
+{
+}
+
+void
+MerkleTree::Node::rehash ()
+{
+  uint8_t flags = (m_left != 0 ? 1 : 0) | (m_right != 0 ? 2 : 0);
+
+  // flags, left subtree digest, leaf digest, right subtree digest
+  uint8_t buffer[sizeof (flags) + 3 * DigestValue::MAX_SIZE];
+  size_t size = 0;
+
+  buffer[size++] = flags; // a single byte, so the digest does not depend on byte order
+  if (m_left != 0)
+    {
+      memcpy (buffer + size, m_left->m_digest.data (), m_left->m_digest.size ());
+      size += m_left->m_digest.size ();
+    }
+  memcpy (buffer + size, m_leaf->getDigest ().data (), m_leaf->getDigest ().size ());
+  size += m_leaf->getDigest ().size ();
+  if (m_right != 0)
+    {
+      memcpy (buffer + size, m_right->m_digest.data (), m_right->m_digest.size ());
+      size += m_right->m_digest.size ();
+    }
+
+  m_digest = Digest::hash (buffer, size);
+
+  m_size = 1 + (m_left != 0 ? m_left->m_size : 0) + (m_right != 0 ? m_right->m_size : 0);
+}
+
+MerkleTree::MerkleTree ()
+  : m_root (0)
+{
+}
+
+MerkleTree::~MerkleTree ()
+{
+  clear ();
+}
+
+void
+MerkleTree::clear ()
+{
+  destroy (m_root);
+  m_root = 0;
+}
+
+void
+MerkleTree::destroy (Node *node)
+{
+  if (node == 0)
+    return;
+
+  destroy (node->m_left);
+  destroy (node->m_right);
+  delete node;
+}
+
+void
+MerkleTree::insert (NameInfoConstPtr info, const FullLeaf *leaf)
+{
+  m_root = insert (m_root, new Node (info, leaf));
+}
+
+bool
+MerkleTree::update (NameInfoConstPtr info)
+{
+  return update (m_root, *info);
+}
+
+bool
+MerkleTree::remove (NameInfoConstPtr info)
+{
+  bool removed = false;
+  m_root = remove (m_root, *info, removed);
+  return removed;
+}
+
+/**
+ * Priorities are compared first by value of the name hash and then by the name itself,
+ * so tree shape is defined even in the unlikely case of equal hashes
+ */
+bool
+MerkleTree::hasHigherPriority (const Node *node1, const Node *node2)
+{
+  return node1->m_priority > node2->m_priority ||
+    (node1->m_priority == node2->m_priority && *node1->m_info < *node2->m_info);
+}
+
+MerkleTree::Node *
+MerkleTree::rotateLeft (Node *node)
+{
+  Node *right = node->m_right;
+  node->m_right = right->m_left;
+  right->m_left = node;
+
+  node->rehash ();
+  right->rehash ();
+  return right;
+}
+
+MerkleTree::Node *
+MerkleTree::rotateRight (Node *node)
+{
+  Node *left = node->m_left;
+  node->m_left = left->m_right;
+  left->m_right = node;
+
+  node->rehash ();
+  left->rehash ();
+  return left;
+}
+
+MerkleTree::Node *
+MerkleTree::insert (Node *node, Node *newNode)
+{
+  if (node == 0)
+    {
+      newNode->rehash ();
+      return newNode;
+    }
+
+  BOOST_ASSERT (!(*newNode->m_info == *node->m_info));
+
+  if (*newNode->m_info < *node->m_info)
+    {
+      node->m_left = insert (node->m_left, newNode);
+      if (hasHigherPriority (node->m_left, node))
+        return rotateRight (node);
+    }
+  else
+    {
+      node->m_right = insert (node->m_right, newNode);
+      if (hasHigherPriority (node->m_right, node))
+        return rotateLeft (node);
+    }
+
+  node->rehash ();
+  return node;
+}
+
+bool
+MerkleTree::update (Node *node, const NameInfo &info)
+{
+  if (node == 0)
+    return false;
+
+  bool found = true;
+  if (info < *node->m_info)
+    found = update (node->m_left, info);
+  else if (*node->m_info < info)
+    found = update (node->m_right, info);
+
+  if (found)
+    node->rehash ();
+  return found;
+}
+
+MerkleTree::Node *
+MerkleTree::remove (Node *node, const NameInfo &info, bool &removed)
+{
+  if (node == 0)
+    return 0;
+
+  if (info < *node->m_info)
+    node->m_left = remove (node->m_left, info, removed);
+  else if (*node->m_info < info)
+    node->m_right = remove (node->m_right, info, removed);
+  else
+    {
+      // rotate node down until it has at most one child, then splice it out
+      if (node->m_left == 0 || node->m_right == 0)
+        {
+          Node *child = node->m_left != 0 ? node->m_left : node->m_right;
+          delete node;
+          removed = true;
+          return child;
+        }
+
+      if (hasHigherPriority (node->m_left, node->m_right))
+        {
+          node = rotateRight (node);
+          node->m_right = remove (node->m_right, info, removed);
+        }
+      else
+        {
+          node = rotateLeft (node);
+          node->m_left = remove (node->m_left, info, removed);
+        }
+    }
+
+  if (removed)
+    node->rehash ();
+  return node;
+}
+
+} // Sync
@@ -0,0 +1,194 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Zhenkai Zhu <zhenkai@cs.ucla.edu>
+ *         Chaoyi Bian <bcy@pku.edu.cn>
+ *	   Alexander Afanasyev <alexander.afanasyev@ucla.edu>
+ */
+
+#ifndef SYNC_MERKLE_TREE_H
+#define SYNC_MERKLE_TREE_H
+
+#include "sync-name-info.h"
+#include "sync-digest.h"
+
+#include <boost/noncopyable.hpp>
+
+namespace Sync {
+
+class FullLeaf;
+
+/**
+ * @ingroup sync
+ * @brief Balanced Merkle tree over the name-ordered sequence of state leaves
+ *
+ * The tree is a treap: nodes are ordered by leaf names (the same order as in
+ * `ordered' index of LeafContainer) and node priorities are derived from the
+ * name digests.  As a result, the shape of the tree depends only on the set of
+ * names, so participants with the same state will always have the same tree and
+ * the same root digest.  Expected depth of the tree is O(log N).
+ *
+ * Every node caches digest of its subtree:
+ *
+ *   hash (flags, hash (left subtree), leaf digest, hash (right subtree)),
+ *
+ * where flags indicate presence of left and right subtrees.  Update of a single
+ * leaf re-hashes only the nodes on the path from the leaf to the root.
+ */
+class MerkleTree : boost::noncopyable
+{
+public:
+  /**
+   * @brief Node of the Merkle tree, representing one leaf and the subtree below it
+   */
+  class Node : boost::noncopyable
+  {
+  public:
+    /**
+     * @brief Get name of the leaf stored in the node
+     */
+    NameInfoConstPtr
+    getInfo () const { return m_info; }
+
+    /**
+     * @brief Get leaf stored in the node
+     */
+    const FullLeaf &
+    getLeaf () const { return *m_leaf; }
+
+    /**
+     * @brief Get digest of the subtree rooted at this node
+     */
+    const DigestValue &
+    getDigest () const { return m_digest; }
+
+    /**
+     * @brief Get left subtree (all names are smaller than node's name), 0 if it is empty
+     */
+    const Node *
+    getLeft () const { return m_left; }
+
+    /**
+     * @brief Get right subtree (all names are larger than node's name), 0 if it is empty
+     */
+    const Node *
+    getRight () const { return m_right; }
+
+    /**
+     * @brief Get number of leaves in the subtree rooted at this node
+     */
+    size_t
+    size () const { return m_size; }
+
+  private:
+    Node (NameInfoConstPtr info, const FullLeaf *leaf);
+
+    void
+    rehash ();
+
+    friend class MerkleTree;
+
+  private:
+    NameInfoConstPtr m_info;
+    const FullLeaf *m_leaf;
+    uint64_t m_priority;
+
+    Node *m_left;
+    Node *m_right;
+    size_t m_size;
+
+    DigestValue m_digest;
+  };
+
+public:
+  /**
+   * @brief Create an empty tree
+   */
+  MerkleTree ();
+  ~MerkleTree ();
+
+  /**
+   * @brief Get root of the tree (0 if tree is empty)
+   */
+  const Node *
+  getRoot () const { return m_root; }
+
+  /**
+   * @brief Get number of leaves in the tree
+   */
+  size_t
+  size () const { return m_root != 0 ? m_root->m_size : 0; }
+
+  /**
+   * @brief Add a new leaf to the tree
+   * @param info name of the leaf (should not be in the tree)
+   * @param leaf leaf, which should be alive as long as it is in the tree
+   */
+  void
+  insert (NameInfoConstPtr info, const FullLeaf *leaf);
+
+  /**
+   * @brief Re-hash path from the leaf to the root after digest of the leaf has changed
+   * @param info name of the leaf
+   * @returns false if there is no leaf with such name
+   */
+  bool
+  update (NameInfoConstPtr info);
+
+  /**
+   * @brief Remove leaf from the tree
+   * @param info name of the leaf
+   * @returns false if there is no leaf with such name
+   */
+  bool
+  remove (NameInfoConstPtr info);
+
+  /**
+   * @brief Remove all leaves from the tree
+   */
+  void
+  clear ();
+
+private:
+  static Node *
+  insert (Node *node, Node *newNode);
+
+  static bool
+  update (Node *node, const NameInfo &info);
+
+  static Node *
+  remove (Node *node, const NameInfo &info, bool &removed);
+
+  static bool
+  hasHigherPriority (const Node *node1, const Node *node2);
+
+  static Node *
+  rotateLeft (Node *node);
+
+  static Node *
+  rotateRight (Node *node);
+
+  static void
+  destroy (Node *node);
+
+private:
+  Node *m_root;
+};
+
+} // Sync
+
+#endif // SYNC_MERKLE_TREE_H
@@ -24,9 +24,6 @@
 #define SYNC_NAME_INFO_H
 
 #include <boost/shared_ptr.hpp>
-#include <boost/weak_ptr.hpp>
-#include <boost/thread/mutex.hpp>
-#include <map>
 #include <string>
 #include "sync-digest.h"
 
@@ -38,9 +35,6 @@ namespace Sync {
  */
 class NameInfo
 {
-private:
-  typedef boost::weak_ptr<const NameInfo> const_weak_ptr;
-  
 public:
   virtual ~NameInfo () { };
 
@@ -67,7 +61,7 @@ public:
   /**
    * @brief Calculates digest of the name
    */
-  const Digest &
+  const DigestValue &
   getDigest () const { return m_digest; }
 
   /**
@@ -80,13 +74,7 @@ public:
 protected:
   // actual stuff
   size_t m_id; ///< @brief Identifies NameInfo throughout the library (for hash container, doesn't need to be strictly unique)
-  Digest m_digest;
-
-  // static stuff
-  typedef std::map<std::string, const_weak_ptr> NameMap;
-  static size_t  m_ids;
-  static NameMap m_names;
-  static boost::mutex m_namesMutex;
+  DigestValue m_digest;
 };
 
 typedef boost::shared_ptr<NameInfo> NameInfoPtr;
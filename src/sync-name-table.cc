@@ -0,0 +1,367 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Zhenkai Zhu <zhenkai@cs.ucla.edu>
+ *         Chaoyi Bian <bcy@pku.edu.cn>
+ *	   Alexander Afanasyev <alexander.afanasyev@ucla.edu>
+ */
+
+#include "sync-name-table.h"
+
+#include <boost/functional/hash.hpp>
+#include <boost/throw_exception.hpp>
+#include <algorithm>
+#include <cstring>
+
+namespace Sync {
+
+static const std::size_t ROOT_HASH = 0;
+
+/**
+ * @brief Get end of the component that starts at begin (components are split before every '/')
+ */
+static inline size_t
+componentEnd (const char *name, size_t begin, size_t length)
+{
+  const char *slash = static_cast<const char*> (std::memchr (name + begin + 1, '/', length - begin - 1));
+  return slash == 0 ? length : slash - name;
+}
+
+NameTable::NameTable ()
+  : m_chunks (MAX_CHUNKS, static_cast<Node*> (0))
+  , m_nodes (0)
+  , m_charsNext (0)
+  , m_charsLeft (0)
+  , m_charsSize (0)
+{
+  for (size_t i = 0; i < SHARDS; i++)
+    {
+      m_shards[i].m_slots.resize (16, 0);
+      m_shards[i].m_size = 0;
+    }
+
+  // root node, i.e., the empty name
+  allocateNode (0, ROOT_HASH, "", 0);
+}
+
+NameTable::~NameTable ()
+{
+  for (size_t i = 0; i < MAX_CHUNKS && m_chunks[i] != 0; i++)
+    delete [] m_chunks[i];
+
+  for (size_t i = 0; i < m_chars.size (); i++)
+    delete [] m_chars[i];
+}
+
+NameInfoConstPtr
+NameTable::findOrInsert (const char *name, size_t length, Factory factory)
+{
+  if (length == 0)
+    {
+      Mutex::scoped_lock lock (shardOf (ROOT_HASH).m_mutex);
+      return getOrCreate (0, name, length, factory);
+    }
+
+  std::size_t hash = ROOT_HASH;
+  for (size_t begin = 0, end = 0; begin < length; begin = end)
+    {
+      end = componentEnd (name, begin, length);
+      hash = hashComponent (hash, name + begin, end - begin);
+    }
+
+  Shard &shard = shardOf (hash);
+  {
+    Mutex::scoped_lock lock (shard.m_mutex);
+
+    NodeId node = findInShard (shard, hash, name, length);
+    if (node != 0)
+      return getOrCreate (node, name, length, factory);
+  }
+
+  // add missing nodes, each one under the lock of its own shard
+  NodeId node = 0;
+  std::size_t prefixHash = ROOT_HASH;
+  for (size_t begin = 0, end = 0; begin < length; begin = end)
+    {
+      end = componentEnd (name, begin, length);
+      prefixHash = hashComponent (prefixHash, name + begin, end - begin);
+      node = findOrInsertComponent (node, prefixHash, name + begin, end - begin);
+    }
+
+  Mutex::scoped_lock lock (shard.m_mutex);
+  return getOrCreate (node, name, length, factory);
+}
+
+void
+NameTable::erase (NodeId node)
+{
+  Node &item = at (node);
+  Mutex::scoped_lock lock (shardOf (item.m_hash).m_mutex);
+
+  if (item.m_info.expired ())
+    item.m_info.reset ();
+}
+
+std::string
+NameTable::toString (NodeId node) const
+{
+  size_t length = 0;
+  for (NodeId i = node; i != 0; i = at (i).m_parent)
+    length += at (i).m_length;
+
+  std::string name (length, '\0');
+  for (NodeId i = node; i != 0; i = at (i).m_parent)
+    {
+      const Node &item = at (i);
+      length -= item.m_length;
+      std::memcpy (&name[length], item.m_component, item.m_length);
+    }
+
+  return name;
+}
+
+int
+NameTable::compare (NodeId node1, NodeId node2) const
+{
+  if (node1 == node2)
+    return 0;
+
+  // go up to the common prefix, remembering nodes of the first different
+  // components (0 if the whole name is the common prefix)
+  NodeId last1 = 0, last2 = 0;
+  NodeId prefix1 = node1, prefix2 = node2;
+  while (at (prefix1).m_depth > at (prefix2).m_depth)
+    {
+      last1 = prefix1;
+      prefix1 = at (prefix1).m_parent;
+    }
+  while (at (prefix2).m_depth > at (prefix1).m_depth)
+    {
+      last2 = prefix2;
+      prefix2 = at (prefix2).m_parent;
+    }
+  while (prefix1 != prefix2)
+    {
+      last1 = prefix1;
+      prefix1 = at (prefix1).m_parent;
+      last2 = prefix2;
+      prefix2 = at (prefix2).m_parent;
+    }
+
+  if (last1 == 0)
+    return -1;
+  if (last2 == 0)
+    return 1;
+
+  const Node &component1 = at (last1);
+  const Node &component2 = at (last2);
+  size_t common = std::min (component1.m_length, component2.m_length);
+  int diff = std::memcmp (component1.m_component, component2.m_component, common);
+  if (diff != 0)
+    return diff;
+
+  // one component is a prefix of the other.  In the full name, the shorter
+  // one is followed either by the end of the name or by '/', and the longer
+  // one by a character that is not '/'
+  if (component1.m_length < component2.m_length)
+    return (last1 == node1 || '/' < static_cast<unsigned char> (component2.m_component[common])) ? -1 : 1;
+  else
+    return (last2 == node2 || '/' < static_cast<unsigned char> (component1.m_component[common])) ? 1 : -1;
+}
+
+size_t
+NameTable::size () const
+{
+  Mutex::scoped_lock lock (m_storageMutex);
+  return m_nodes;
+}
+
+size_t
+NameTable::getMemoryUsage () const
+{
+  size_t usage = 0;
+  for (size_t i = 0; i < SHARDS; i++)
+    {
+      Mutex::scoped_lock lock (m_shards[i].m_mutex);
+      usage += m_shards[i].m_slots.capacity () * sizeof (NodeId);
+    }
+
+  Mutex::scoped_lock lock (m_storageMutex);
+  usage += m_chunks.capacity () * sizeof (Node*);
+  usage += (m_nodes + CHUNK_NODES - 1) / CHUNK_NODES * CHUNK_NODES * sizeof (Node);
+  usage += m_charsSize;
+  return usage;
+}
+
+const NameTable::Node &
+NameTable::at (NodeId node) const
+{
+  return m_chunks[node / CHUNK_NODES][node % CHUNK_NODES];
+}
+
+NameTable::Node &
+NameTable::at (NodeId node)
+{
+  return m_chunks[node / CHUNK_NODES][node % CHUNK_NODES];
+}
+
+NameTable::Shard &
+NameTable::shardOf (std::size_t hash)
+{
+  return m_shards[hash % SHARDS];
+}
+
+std::size_t
+NameTable::hashComponent (std::size_t parentHash, const char *component, size_t length)
+{
+  std::size_t hash = parentHash;
+  boost::hash_combine (hash, boost::hash_range (component, component + length));
+  return hash;
+}
+
+bool
+NameTable::equals (NodeId node, const char *name, size_t length) const
+{
+  // compare from the last component
+  for (; node != 0; node = at (node).m_parent)
+    {
+      const Node &item = at (node);
+      if (item.m_length > length ||
+          std::memcmp (name + length - item.m_length, item.m_component, item.m_length) != 0)
+        return false;
+
+      length -= item.m_length;
+    }
+
+  return length == 0;
+}
+
+NameTable::NodeId
+NameTable::findInShard (const Shard &shard, std::size_t hash, const char *name, size_t length) const
+{
+  size_t mask = shard.m_slots.size () - 1;
+  for (size_t slot = (hash / SHARDS) & mask; shard.m_slots[slot] != 0; slot = (slot + 1) & mask)
+    {
+      NodeId node = shard.m_slots[slot];
+      if (at (node).m_hash == hash && equals (node, name, length))
+        return node;
+    }
+
+  return 0;
+}
+
+NameInfoConstPtr
+NameTable::getOrCreate (NodeId node, const char *name, size_t length, Factory factory)
+{
+  Node &item = at (node);
+
+  // can be expired, if the last reference has gone, but erase () has not been called yet
+  NameInfoConstPtr info = item.m_info.lock ();
+  if (info == 0)
+    {
+      info = NameInfoConstPtr (factory (node, name, length));
+      item.m_info = info;
+    }
+
+  return info;
+}
+
+NameTable::NodeId
+NameTable::findOrInsertComponent (NodeId parent, std::size_t hash, const char *component, size_t length)
+{
+  Shard &shard = shardOf (hash);
+  Mutex::scoped_lock lock (shard.m_mutex);
+
+  size_t mask = shard.m_slots.size () - 1;
+  for (size_t slot = (hash / SHARDS) & mask; shard.m_slots[slot] != 0; slot = (slot + 1) & mask)
+    {
+      const Node &item = at (shard.m_slots[slot]);
+      if (item.m_hash == hash && item.m_parent == parent && item.m_length == length &&
+          std::memcmp (item.m_component, component, length) == 0)
+        return shard.m_slots[slot];
+    }
+
+  NodeId node = allocateNode (parent, hash, component, length);
+  insertToShard (shard, node);
+  return node;
+}
+
+NameTable::NodeId
+NameTable::allocateNode (NodeId parent, std::size_t hash, const char *component, size_t length)
+{
+  Mutex::scoped_lock lock (m_storageMutex);
+
+  if (m_nodes / CHUNK_NODES >= MAX_CHUNKS || length > 0xffff)
+    BOOST_THROW_EXCEPTION (Error::NameTableOverflow ());
+
+  NodeId node = m_nodes;
+  if (m_chunks[node / CHUNK_NODES] == 0)
+    m_chunks[node / CHUNK_NODES] = new Node [CHUNK_NODES];
+
+  if (length > m_charsLeft)
+    {
+      m_chars.push_back (new char [CHARS_CHUNK]);
+      m_charsNext = m_chars.back ();
+      m_charsLeft = CHARS_CHUNK;
+      m_charsSize += CHARS_CHUNK;
+    }
+
+  Node &item = at (node);
+  item.m_component = m_charsNext;
+  item.m_hash = hash;
+  item.m_parent = parent;
+  item.m_length = length;
+  item.m_depth = (node == 0) ? 0 : at (parent).m_depth + 1;
+
+  std::memcpy (m_charsNext, component, length);
+  m_charsNext += length;
+  m_charsLeft -= length;
+
+  m_nodes ++;
+  return node;
+}
+
+void
+NameTable::insertToShard (Shard &shard, NodeId node)
+{
+  if (2 * (shard.m_size + 1) > shard.m_slots.size ())
+    {
+      std::vector<NodeId> slots (2 * shard.m_slots.size (), 0);
+      size_t mask = slots.size () - 1;
+      for (size_t i = 0; i < shard.m_slots.size (); i++)
+        {
+          if (shard.m_slots[i] == 0)
+            continue;
+
+          size_t slot = (at (shard.m_slots[i]).m_hash / SHARDS) & mask;
+          while (slots[slot] != 0)
+            slot = (slot + 1) & mask;
+          slots[slot] = shard.m_slots[i];
+        }
+      shard.m_slots.swap (slots);
+    }
+
+  size_t mask = shard.m_slots.size () - 1;
+  size_t slot = (at (node).m_hash / SHARDS) & mask;
+  while (shard.m_slots[slot] != 0)
+    slot = (slot + 1) & mask;
+
+  shard.m_slots[slot] = node;
+  shard.m_size ++;
+}
+
+} // Sync
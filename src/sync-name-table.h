@@ -0,0 +1,186 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Zhenkai Zhu <zhenkai@cs.ucla.edu>
+ *         Chaoyi Bian <bcy@pku.edu.cn>
+ *	   Alexander Afanasyev <alexander.afanasyev@ucla.edu>
+ */
+
+#ifndef SYNC_NAME_TABLE_H
+#define SYNC_NAME_TABLE_H
+
+#include "sync-name-info.h"
+#include "sync-threading-policy.h"
+
+#include <boost/noncopyable.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/cstdint.hpp>
+#include <string>
+#include <vector>
+
+namespace Sync {
+
+/**
+ * @ingroup sync
+ * @brief Table of all existing NameInfo objects (names are interned, i.e., there is only one object per name)
+ *
+ * Names are kept in a trie of components ("/org", "/site", "/user-1", ...),
+ * so a common prefix of many names is stored only once and every name is
+ * identified by a compact node ID.  Characters of a name are not stored
+ * anywhere else, NameInfo objects keep just the node ID.
+ *
+ * Nodes are found by hash of the full name, which is calculated
+ * incrementally (the hash of a node is derived from the hash of its parent
+ * and its component).  The hash index is split into shards, each shard with
+ * its own lock, so lookups of different names from different threads (e.g.,
+ * several SyncLogic instances) rarely contend.  Names can be looked up
+ * directly from a character buffer, without constructing std::string.
+ *
+ * Nodes are never removed: memory of the trie is proportional to the number
+ * of distinct names ever seen, NameInfo objects are released as usual
+ */
+class NameTable : boost::noncopyable
+{
+public:
+  typedef uint32_t NodeId;
+
+  /**
+   * @brief Function to create a new NameInfo object for the name
+   */
+  typedef NameInfo *(*Factory) (NodeId node, const char *name, size_t length);
+
+  NameTable ();
+  ~NameTable ();
+
+  /**
+   * @brief Find existing or add a new NameInfo object
+   * @param name pointer to characters of the name (does not need to be null-terminated)
+   * @param length number of characters
+   * @param factory function to create the object if the name is not in the table (called with shard locked)
+   */
+  NameInfoConstPtr
+  findOrInsert (const char *name, size_t length, Factory factory);
+
+  /**
+   * @brief Forget NameInfo object of the node, unless it has already been recreated (should be called from the destructor of NameInfo)
+   */
+  void
+  erase (NodeId node);
+
+  /**
+   * @brief Get the name of the node
+   */
+  std::string
+  toString (NodeId node) const;
+
+  /**
+   * @brief Compare names of two nodes
+   * @returns negative, zero, or positive value, the same as std::string::compare would return for the names
+   */
+  int
+  compare (NodeId node1, NodeId node2) const;
+
+  /**
+   * @brief Get number of nodes in the trie (names and their prefixes)
+   */
+  size_t
+  size () const;
+
+  /**
+   * @brief Get approximate amount of memory used by the trie (excluding NameInfo objects)
+   */
+  size_t
+  getMemoryUsage () const;
+
+private:
+  struct Node
+  {
+    const char *m_component; ///< @brief characters of the last component (starts with '/', unless it is the first one)
+    std::size_t m_hash;      ///< @brief hash of the full name
+    NodeId m_parent;
+    uint16_t m_length;       ///< @brief length of the component
+    uint16_t m_depth;        ///< @brief number of components
+    boost::weak_ptr<const NameInfo> m_info; ///< @brief guarded by the lock of the node's shard
+  };
+
+  typedef ThreadingPolicy::Mutex Mutex;
+
+  /**
+   * @brief Open-addressing hash index of the nodes of one shard
+   */
+  struct Shard
+  {
+    std::vector<NodeId> m_slots; ///< @brief node IDs (0, i.e., the root, is never in the index and marks an empty slot)
+    size_t m_size;
+    mutable Mutex m_mutex;
+  };
+
+  const Node &
+  at (NodeId node) const;
+
+  Node &
+  at (NodeId node);
+
+  Shard &
+  shardOf (std::size_t hash);
+
+  static std::size_t
+  hashComponent (std::size_t parentHash, const char *component, size_t length);
+
+  bool
+  equals (NodeId node, const char *name, size_t length) const;
+
+  NodeId
+  findOrInsertComponent (NodeId parent, std::size_t hash, const char *component, size_t length);
+
+  NodeId
+  allocateNode (NodeId parent, std::size_t hash, const char *component, size_t length);
+
+  NodeId
+  findInShard (const Shard &shard, std::size_t hash, const char *name, size_t length) const;
+
+  NameInfoConstPtr
+  getOrCreate (NodeId node, const char *name, size_t length, Factory factory);
+
+  void
+  insertToShard (Shard &shard, NodeId node);
+
+private:
+  static const size_t SHARDS = 16;
+  static const size_t CHUNK_NODES = 4096;
+  static const size_t MAX_CHUNKS = 16384;
+  static const size_t CHARS_CHUNK = 65536;
+
+  Shard m_shards[SHARDS];
+
+  // storage of nodes and their components, addresses never change, so nodes can be read without a lock
+  std::vector<Node*> m_chunks; ///< @brief allocated with MAX_CHUNKS entries and never resized
+  NodeId m_nodes;
+  std::vector<char*> m_chars;
+  char *m_charsNext;
+  size_t m_charsLeft;
+  size_t m_charsSize;
+  mutable Mutex m_storageMutex;
+};
+
+namespace Error {
+struct NameTableOverflow : virtual boost::exception, virtual std::exception { };
+} // Error
+
+} // Sync
+
+#endif // SYNC_NAME_TABLE_H
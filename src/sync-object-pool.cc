@@ -0,0 +1,133 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Zhenkai Zhu <zhenkai@cs.ucla.edu>
+ *         Chaoyi Bian <bcy@pku.edu.cn>
+ *	   Alexander Afanasyev <alexander.afanasyev@ucla.edu>
+ */
+
+#include "sync-object-pool.h"
+
+#include <boost/assert.hpp>
+#include <boost/foreach.hpp>
+
+namespace Sync {
+
+static inline size_t
+sizeClass (size_t size)
+{
+  return (size + ObjectPool::BLOCK_GRANULARITY - 1) / ObjectPool::BLOCK_GRANULARITY - 1;
+}
+
+ObjectPool::ObjectPool (size_t slabSize)
+  : m_slabSize (slabSize)
+  , m_freeLists (MAX_BLOCK_SIZE / BLOCK_GRANULARITY, static_cast<FreeBlock*> (0))
+  , m_slabPosition (0)
+  , m_slabLeft (0)
+{
+  BOOST_ASSERT (m_slabSize >= MAX_BLOCK_SIZE);
+
+  m_statistics.allocations = 0;
+  m_statistics.deallocations = 0;
+  m_statistics.bytesAllocated = 0;
+  m_statistics.bytesInUse = 0;
+  m_statistics.slabs = 0;
+  m_statistics.heapAllocations = 0;
+}
+
+ObjectPool::~ObjectPool ()
+{
+  BOOST_FOREACH (char *slab, m_slabs)
+    {
+      ::operator delete (slab);
+    }
+}
+
+void *
+ObjectPool::allocate (size_t size)
+{
+  if (size == 0)
+    size = 1;
+
+  Mutex::scoped_lock lock (m_mutex);
+  if (size > MAX_BLOCK_SIZE)
+    {
+      m_statistics.heapAllocations ++;
+      lock.unlock ();
+      return ::operator new (size);
+    }
+
+  size_t cls = sizeClass (size);
+  size_t blockSize = (cls + 1) * BLOCK_GRANULARITY;
+
+  m_statistics.allocations ++;
+  m_statistics.bytesAllocated += blockSize;
+  m_statistics.bytesInUse += blockSize;
+
+  FreeBlock *block = m_freeLists[cls];
+  if (block != 0)
+    {
+      m_freeLists[cls] = block->next;
+      return block;
+    }
+
+  if (m_slabLeft < blockSize)
+    {
+      // remainder of the current slab is abandoned (it is smaller than any block that could not fit)
+      m_slabPosition = static_cast<char*> (::operator new (m_slabSize));
+      m_slabLeft = m_slabSize;
+      m_slabs.push_back (m_slabPosition);
+      m_statistics.slabs ++;
+    }
+
+  void *ret = m_slabPosition;
+  m_slabPosition += blockSize;
+  m_slabLeft -= blockSize;
+  return ret;
+}
+
+void
+ObjectPool::deallocate (void *block, size_t size)
+{
+  if (size == 0)
+    size = 1;
+
+  if (size > MAX_BLOCK_SIZE)
+    {
+      ::operator delete (block);
+      return;
+    }
+
+  size_t cls = sizeClass (size);
+
+  Mutex::scoped_lock lock (m_mutex);
+  m_statistics.deallocations ++;
+  m_statistics.bytesInUse -= (cls + 1) * BLOCK_GRANULARITY;
+
+  FreeBlock *freeBlock = static_cast<FreeBlock*> (block);
+  freeBlock->next = m_freeLists[cls];
+  m_freeLists[cls] = freeBlock;
+}
+
+ObjectPool::Statistics
+ObjectPool::getStatistics () const
+{
+  Mutex::scoped_lock lock (m_mutex);
+  return m_statistics;
+}
+
+} // Sync
@@ -0,0 +1,206 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Zhenkai Zhu <zhenkai@cs.ucla.edu>
+ *         Chaoyi Bian <bcy@pku.edu.cn>
+ *	   Alexander Afanasyev <alexander.afanasyev@ucla.edu>
+ */
+
+#ifndef SYNC_OBJECT_POOL_H
+#define SYNC_OBJECT_POOL_H
+
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+#include <vector>
+#include <new>
+
+#include "sync-threading-policy.h"
+
+namespace Sync {
+
+/**
+ * \ingroup sync
+ * @brief Slab allocator for small objects (leaves, diff states, container nodes)
+ *
+ * Memory is requested from the global heap in large slabs and carved into
+ * blocks of a few size classes.  Released blocks are kept in per-class free
+ * lists and reused for the following allocations, so steady churn of
+ * short-living objects does not hit the global heap.  Requests larger than
+ * MAX_BLOCK_SIZE are passed to the global heap.
+ *
+ * Memory is returned to the global heap only when the pool is destroyed, so
+ * the pool must outlive all objects allocated from it.
+ */
+class ObjectPool : boost::noncopyable
+{
+public:
+  /**
+   * @brief Allocation counters
+   */
+  struct Statistics
+  {
+    size_t allocations;     ///< @brief number of blocks handed out from the pool
+    size_t deallocations;   ///< @brief number of blocks returned to the pool
+    size_t bytesAllocated;  ///< @brief total volume of blocks handed out from the pool
+    size_t bytesInUse;      ///< @brief volume of blocks currently in use
+    size_t slabs;           ///< @brief number of slabs requested from the global heap
+    size_t heapAllocations; ///< @brief number of requests passed to the global heap (too large for the pool)
+  };
+
+  static const size_t BLOCK_GRANULARITY = 16; ///< @brief blocks sizes are multiples of this value (also alignment of the blocks)
+  static const size_t MAX_BLOCK_SIZE = 512;   ///< @brief largest block that is served from the pool
+
+  /**
+   * @brief Constructor
+   * @param slabSize size of memory chunks requested from the global heap
+   */
+  ObjectPool (size_t slabSize = 64 * 1024);
+  ~ObjectPool ();
+
+  /**
+   * @brief Allocate memory block of at least size bytes
+   */
+  void *
+  allocate (size_t size);
+
+  /**
+   * @brief Return memory block to the pool
+   * @param block block returned by allocate ()
+   * @param size the same size as was requested from allocate ()
+   */
+  void
+  deallocate (void *block, size_t size);
+
+  /**
+   * @brief Get snapshot of the allocation counters
+   */
+  Statistics
+  getStatistics () const;
+
+private:
+  struct FreeBlock
+  {
+    FreeBlock *next;
+  };
+
+private:
+  size_t m_slabSize;
+  std::vector<FreeBlock*> m_freeLists; ///< @brief free list for every size class
+  std::vector<char*> m_slabs;
+  char *m_slabPosition;
+  size_t m_slabLeft;
+
+  Statistics m_statistics;
+  typedef ThreadingPolicy::Mutex Mutex;
+  mutable Mutex m_mutex;
+};
+
+typedef boost::shared_ptr<ObjectPool> ObjectPoolPtr;
+
+/**
+ * \ingroup sync
+ * @brief Standard allocator interface for ObjectPool
+ *
+ * Can be used with allocate_shared and containers.  Allocator keeps only a
+ * plain pointer to the pool (a copy of the allocator is stored along with
+ * every shared object), so the owner of the objects (FullState, DiffState,
+ * SyncLogic) should also own the pool.  Allocator without a pool uses the
+ * global heap.
+ */
+template<class T>
+class PoolAllocator
+{
+public:
+  typedef T value_type;
+  typedef T *pointer;
+  typedef const T *const_pointer;
+  typedef T &reference;
+  typedef const T &const_reference;
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+
+  template<class U>
+  struct rebind
+  {
+    typedef PoolAllocator<U> other;
+  };
+
+  PoolAllocator (const ObjectPoolPtr &pool = ObjectPoolPtr ()) : m_pool (pool.get ()) { }
+
+  template<class U>
+  PoolAllocator (const PoolAllocator<U> &other) : m_pool (other.getPool ()) { }
+
+  /**
+   * @brief Get the pool (0 if global heap is used)
+   */
+  ObjectPool *
+  getPool () const { return m_pool; }
+
+  pointer
+  address (reference value) const { return &value; }
+
+  const_pointer
+  address (const_reference value) const { return &value; }
+
+  pointer
+  allocate (size_type n, const void * = 0)
+  {
+    if (m_pool != 0)
+      return static_cast<pointer> (m_pool->allocate (n * sizeof (T)));
+    else
+      return static_cast<pointer> (::operator new (n * sizeof (T)));
+  }
+
+  void
+  deallocate (pointer p, size_type n)
+  {
+    if (m_pool != 0)
+      m_pool->deallocate (p, n * sizeof (T));
+    else
+      ::operator delete (p);
+  }
+
+  size_type
+  max_size () const { return static_cast<size_type> (-1) / sizeof (T); }
+
+  void
+  construct (pointer p, const T &value) { new (p) T (value); }
+
+  void
+  destroy (pointer p) { p->~T (); }
+
+private:
+  ObjectPool *m_pool;
+};
+
+template<class T, class U>
+inline bool
+operator == (const PoolAllocator<T> &a, const PoolAllocator<U> &b)
+{
+  return a.getPool () == b.getPool ();
+}
+
+template<class T, class U>
+inline bool
+operator != (const PoolAllocator<T> &a, const PoolAllocator<U> &b)
+{
+  return a.getPool () != b.getPool ();
+}
+
+} // Sync
+
+#endif // SYNC_OBJECT_POOL_H
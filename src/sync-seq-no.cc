@@ -21,19 +21,15 @@
  */
 
 #include "sync-seq-no.h"
-#include <boost/make_shared.hpp>
-
-using namespace boost;
 
 namespace Sync {
 
-DigestConstPtr
+DigestValue
 SeqNo::getDigest () const
 {
-  DigestPtr digest = make_shared<Digest> ();
-  *digest << m_session << m_seq;
-  digest->finalize ();
-  return digest;
+  // the same as Digest () << m_session << m_seq
+  uint32_t value[2] = { m_session, m_seq };
+  return Digest::hash (value, sizeof (value));
 }
 
 } // Sync
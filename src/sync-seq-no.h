@@ -94,7 +94,7 @@ public:
    *
    * Digest will be calculated every time it is requested
    */
-  DigestConstPtr
+  DigestValue
   getDigest () const;
 
   /**
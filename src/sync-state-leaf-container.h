@@ -25,6 +25,7 @@
 
 #include "sync-leaf.h"
 #include "sync-name-info.h"
+#include "sync-flat-leaf-container.h"
 
 #include <boost/multi_index_container.hpp>
 // #include <boost/multi_index/tag.hpp>
@@ -71,31 +72,78 @@ struct hashed { };
 struct ordered { };
 /// @endcond
 
+#ifdef FLAT_LEAF_CONTAINER
+
 /**
  * \ingroup sync
- * @brief Container for SYNC leaves
+ * @brief Container for SYNC leaves of type LeafType (flat implementation, see ./waf configure --flat-leaf-container)
  */
-struct LeafContainer : public mi::multi_index_container<
-  LeafPtr,
-  mi::indexed_by<
-    // For fast access to elements using NameInfo
-    mi::hashed_unique<
-      mi::tag<hashed>,
-      mi::const_mem_fun<Leaf, NameInfoConstPtr, &Leaf::getInfo>,
-      NameInfoHash,
-      NameInfoEqual
-      >,
+template<class LeafType>
+struct LeafContainer : public FlatLeafContainer<LeafType>
+{
+  /**
+   * @brief Constructor
+   * @param pool pool to allocate memory from (global heap if not set)
+   */
+  LeafContainer (const ObjectPoolPtr &pool = ObjectPoolPtr ())
+    : FlatLeafContainer<LeafType> (pool)
+  {
+  }
+};
+
+#else
+
+/// @cond include_hidden
+template<class LeafType>
+struct LeafMultiIndexContainer
+{
+  typedef mi::multi_index_container<
+    boost::shared_ptr<LeafType>,
+    mi::indexed_by<
+      // For fast access to elements using NameInfo
+      mi::hashed_unique<
+        mi::tag<hashed>,
+        mi::const_mem_fun<Leaf, const NameInfoConstPtr &, &Leaf::getInfo>,
+        NameInfoHash,
+        NameInfoEqual
+        >,
         
-    mi::ordered_unique<
-      mi::tag<ordered>,
-      mi::const_mem_fun<Leaf, NameInfoConstPtr, &Leaf::getInfo>,
-      NameInfoCompare
-      >
-    >
-  >
+      mi::ordered_unique<
+        mi::tag<ordered>,
+        mi::const_mem_fun<Leaf, const NameInfoConstPtr &, &Leaf::getInfo>,
+        NameInfoCompare
+        >
+      >,
+    PoolAllocator<boost::shared_ptr<LeafType> >
+    > type;
+};
+/// @endcond
+
+/**
+ * \ingroup sync
+ * @brief Container for SYNC leaves of type LeafType
+ *
+ * Elements are statically typed (e.g., LeafContainer<FullLeaf> holds
+ * FullLeafPtr), so no casts are necessary to access leaf-specific fields
+ */
+template<class LeafType>
+struct LeafContainer : public LeafMultiIndexContainer<LeafType>::type
 {
+  typedef typename LeafMultiIndexContainer<LeafType>::type base_type;
+
+  /**
+   * @brief Constructor
+   * @param pool pool to allocate container nodes from (global heap if not set)
+   */
+  LeafContainer (const ObjectPoolPtr &pool = ObjectPoolPtr ())
+    : base_type (typename base_type::ctor_args_list (),
+                 typename base_type::allocator_type (pool))
+  {
+  }
 };
 
+#endif // FLAT_LEAF_CONTAINER
+
 } // Sync
 
 #endif // SYNC_STATE_LEAF_CONTAINER
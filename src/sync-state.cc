@@ -21,7 +21,8 @@
  */
 
 #include "sync-state.h"
-#include "sync-diff-leaf.h"
+#include "sync-full-state.h"
+#include "sync-diff-state.h"
 #include "sync-std-name-info.h"
 
 #include <boost/assert.hpp>
@@ -30,8 +31,20 @@
 #include <boost/throw_exception.hpp>
 #include <boost/lexical_cast.hpp>
 
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
+// arenas are enabled for all messages since protobuf 3.14 (sync-state.proto
+// does not set cc_enable_arenas, which protoc 2.x does not understand)
+#if GOOGLE_PROTOBUF_VERSION >= 3014000
+#include <google/protobuf/arena.h>
+#endif
+
+#include <algorithm>
+
 using namespace std;
 using namespace boost;
+using google::protobuf::io::CodedInputStream;
+using google::protobuf::internal::WireFormatLite;
 
 typedef error_info<struct tag_errmsg, string> info_str; 
 
@@ -67,14 +80,28 @@ operator << (std::ostream &os, const State &state)
 }
 */
 
-SyncStateMsg &
-operator << (SyncStateMsg &ossm, const State &state)
+static inline Operation
+leafOperation (const FullLeaf &)
 {
-  BOOST_FOREACH (shared_ptr<const Leaf> leaf, state.getLeaves ().get<ordered> ())
+  return UPDATE;
+}
+
+static inline Operation
+leafOperation (const DiffLeaf &leaf)
+{
+  return leaf.getOperation ();
+}
+
+template<class LeafType>
+static void
+formatLeaves (SyncStateMsg &ossm, const LeafContainer<LeafType> &leaves)
+{
+  ossm.mutable_ss ()->Reserve (ossm.ss_size () + leaves.size ());
+  BOOST_FOREACH (const shared_ptr<LeafType> &leaf, leaves.template get<ordered> ())
   {
     SyncState *oss = ossm.add_ss();
-    shared_ptr<const DiffLeaf> diffLeaf = dynamic_pointer_cast<const DiffLeaf> (leaf);
-    if (diffLeaf != 0 && diffLeaf->getOperation() != UPDATE)
+    Operation op = leafOperation (*leaf);
+    if (op != UPDATE)
     {
       oss->set_type(SyncState::DELETE);
     }
@@ -83,20 +110,208 @@ operator << (SyncStateMsg &ossm, const State &state)
       oss->set_type(SyncState::UPDATE);
     }
 
-    std::ostringstream os;
-    os << *leaf->getInfo();
-    oss->set_name(os.str());
+    oss->set_name(leaf->getInfo()->toString());
 
-    if (diffLeaf == 0 || (diffLeaf != 0 && diffLeaf->getOperation () == UPDATE))
+    if (op == UPDATE)
     {
       SyncState::SeqNo *seqNo = oss->mutable_seqno();
       seqNo->set_session(leaf->getSeq().getSession());
       seqNo->set_seq(leaf->getSeq().getSeq());
     }
   }
+}
+
+SyncStateMsg &
+operator << (SyncStateMsg &ossm, const FullState &state)
+{
+  formatLeaves (ossm, state.getLeaves ());
+  return ossm;
+}
+
+SyncStateMsg &
+operator << (SyncStateMsg &ossm, const DiffState &state)
+{
+  formatLeaves (ossm, state.getLeaves ());
   return ossm;
 }
 
+static inline void
+appendVarint (string &out, uint64_t value)
+{
+  while (value >= 0x80)
+    {
+      out.push_back (static_cast<char> (value | 0x80));
+      value >>= 7;
+    }
+  out.push_back (static_cast<char> (value));
+}
+
+static inline uint64_t
+readVarint (const unsigned char *&pos, const unsigned char *end)
+{
+  uint64_t value = 0;
+  for (int shift = 0; shift < 64; shift += 7)
+    {
+      if (pos == end)
+        BOOST_THROW_EXCEPTION (SyncStateMsgDecodingFailure () << info_str ("Truncated varint"));
+
+      uint64_t byte = *pos++;
+      value |= (byte & 0x7f) << shift;
+      if (byte < 0x80)
+        return value;
+    }
+  BOOST_THROW_EXCEPTION (SyncStateMsgDecodingFailure () << info_str ("Varint is too long"));
+}
+
+// sessions and sequence numbers are coded as signed differences from the previous leaf
+static inline uint64_t
+zigzagDelta (uint32_t value, uint32_t previous)
+{
+  int64_t delta = static_cast<int64_t> (value) - previous;
+  return (static_cast<uint64_t> (delta) << 1) ^ static_cast<uint64_t> (delta >> 63);
+}
+
+static inline uint32_t
+readZigzagDelta (const unsigned char *&pos, const unsigned char *end, uint32_t previous)
+{
+  uint64_t zigzag = readVarint (pos, end);
+  int64_t value = previous + static_cast<int64_t> ((zigzag >> 1) ^ -(zigzag & 1));
+  if (value < 0 || value > 0xffffffffLL)
+    BOOST_THROW_EXCEPTION (SyncStateMsgDecodingFailure () << info_str ("Sequence number is out of range"));
+
+  return static_cast<uint32_t> (value);
+}
+
+/*
+ * Compact format (version 1):
+ *
+ *   COMPACT_WIRE_FORMAT_V1, varint number of leaves, then for every leaf in name order:
+ *
+ *     varint (prefix << 1 | remove)  -- length of the name prefix shared with the previous leaf
+ *     varint suffix length, suffix   -- the rest of the name
+ *     zigzag varint session delta,
+ *     zigzag varint seq delta        -- only for updates, relative to the previous update
+ */
+template<class LeafType>
+static void
+formatCompactLeaves (string &out, const LeafContainer<LeafType> &leaves)
+{
+  out.push_back (static_cast<char> (COMPACT_WIRE_FORMAT_V1));
+  appendVarint (out, leaves.size ());
+
+  string previousName;
+  SeqNo previousSeq (0, 0);
+  BOOST_FOREACH (const shared_ptr<LeafType> &leaf, leaves.template get<ordered> ())
+    {
+      string name = leaf->getInfo ()->toString ();
+      size_t prefix = 0;
+      size_t maxPrefix = std::min (name.size (), previousName.size ());
+      while (prefix < maxPrefix && name[prefix] == previousName[prefix])
+        prefix++;
+
+      Operation op = leafOperation (*leaf);
+      appendVarint (out, (static_cast<uint64_t> (prefix) << 1) | (op != UPDATE ? 1 : 0));
+      appendVarint (out, name.size () - prefix);
+      out.append (name, prefix, string::npos);
+
+      if (op == UPDATE)
+        {
+          const SeqNo &seq = leaf->getSeq ();
+          appendVarint (out, zigzagDelta (seq.getSession (), previousSeq.getSession ()));
+          appendVarint (out, zigzagDelta (seq.getSeq (), previousSeq.getSeq ()));
+          previousSeq = seq;
+        }
+
+      previousName.swap (name);
+    }
+}
+
+static void
+parseCompactState (const char *wireData, size_t len, StateVisitor &visitor)
+{
+  const unsigned char *pos = reinterpret_cast<const unsigned char *> (wireData);
+  const unsigned char *end = pos + len;
+  if (pos == end || *pos++ != COMPACT_WIRE_FORMAT_V1)
+    BOOST_THROW_EXCEPTION (SyncStateMsgDecodingFailure () << info_str ("Unknown version of compact format"));
+
+  uint64_t count = readVarint (pos, end);
+
+  string name;
+  uint32_t session = 0;
+  uint32_t seq = 0;
+  for (uint64_t i = 0; i < count; i++)
+    {
+      uint64_t header = readVarint (pos, end);
+      uint64_t prefix = header >> 1;
+      uint64_t suffix = readVarint (pos, end);
+      if (prefix > name.size () || suffix > static_cast<uint64_t> (end - pos))
+        BOOST_THROW_EXCEPTION (SyncStateMsgDecodingFailure () << info_str ("Invalid name length"));
+
+      name.resize (prefix);
+      name.append (reinterpret_cast<const char *> (pos), suffix);
+      pos += suffix;
+
+      NameInfoConstPtr info = StdNameInfo::FindOrCreate (name.c_str (), name.size ());
+      if ((header & 1) == 0)
+        {
+          session = readZigzagDelta (pos, end, session);
+          seq = readZigzagDelta (pos, end, seq);
+          visitor.visitUpdate (info, SeqNo (session, seq));
+        }
+      else
+        {
+          visitor.visitRemove (info);
+        }
+    }
+
+  if (pos != end)
+    BOOST_THROW_EXCEPTION (SyncStateMsgDecodingFailure () << info_str ("Garbage after the last leaf"));
+}
+
+#if GOOGLE_PROTOBUF_VERSION >= 3014000
+static const size_t ARENA_START_BLOCK_SIZE = 4096;
+static const size_t ARENA_MAX_BLOCK_SIZE = 1024 * 1024;
+#endif
+
+template<class StateType>
+static void
+encodeLeaves (const StateType &state, WireFormat format, string &wireData)
+{
+  wireData.clear ();
+  if (format == COMPACT_WIRE_FORMAT)
+    {
+      formatCompactLeaves (wireData, state.getLeaves ());
+    }
+  else
+    {
+#if GOOGLE_PROTOBUF_VERSION >= 3014000
+      // all SyncState and SeqNo submessages are allocated from the arena and released at once
+      google::protobuf::ArenaOptions options;
+      options.start_block_size = ARENA_START_BLOCK_SIZE;
+      options.max_block_size = ARENA_MAX_BLOCK_SIZE;
+      google::protobuf::Arena arena (options);
+      SyncStateMsg *ssm = google::protobuf::Arena::CreateMessage<SyncStateMsg> (&arena);
+#else
+      SyncStateMsg message;
+      SyncStateMsg *ssm = &message;
+#endif
+      formatLeaves (*ssm, state.getLeaves ());
+      ssm->SerializeToString (&wireData);
+    }
+}
+
+void
+encodeState (const FullState &state, WireFormat format, std::string &wireData)
+{
+  encodeLeaves (state, format, wireData);
+}
+
+void
+encodeState (const DiffState &state, WireFormat format, std::string &wireData)
+{
+  encodeLeaves (state, format, wireData);
+}
+
 /*
 std::istream &
 operator >> (std::istream &in, State &state)
@@ -169,4 +384,158 @@ operator >> (SyncStateMsg &issm, State &state)
   return issm;
 }
 
+// tags of SyncStateMsg fields (see sync-state.proto)
+static const uint32_t MSG_SS_TAG = WireFormatLite::MakeTag (1, WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+static const uint32_t SS_NAME_TAG = WireFormatLite::MakeTag (1, WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+static const uint32_t SS_TYPE_TAG = WireFormatLite::MakeTag (2, WireFormatLite::WIRETYPE_VARINT);
+static const uint32_t SS_SEQNO_TAG = WireFormatLite::MakeTag (3, WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+static const uint32_t SEQNO_SEQ_TAG = WireFormatLite::MakeTag (1, WireFormatLite::WIRETYPE_VARINT);
+static const uint32_t SEQNO_SESSION_TAG = WireFormatLite::MakeTag (2, WireFormatLite::WIRETYPE_VARINT);
+
+static inline void
+checkDecoding (bool ok, const char *message)
+{
+  if (!ok)
+    BOOST_THROW_EXCEPTION (SyncStateMsgDecodingFailure () << info_str (message));
+}
+
+static inline void
+skipField (CodedInputStream &input, uint32_t tag)
+{
+  checkDecoding (WireFormatLite::SkipField (&input, tag), "Invalid unknown field");
+}
+
+static SeqNo
+parseSeqNo (CodedInputStream &input)
+{
+  uint32_t length = 0;
+  checkDecoding (input.ReadVarint32 (&length), "Invalid SeqNo length");
+  CodedInputStream::Limit limit = input.PushLimit (length);
+
+  uint32_t seq = 0, session = 0;
+  bool hasSeq = false, hasSession = false;
+  while (uint32_t tag = input.ReadTag ())
+    {
+      if (tag == SEQNO_SEQ_TAG)
+        {
+          checkDecoding (input.ReadVarint32 (&seq), "Invalid seq");
+          hasSeq = true;
+        }
+      else if (tag == SEQNO_SESSION_TAG)
+        {
+          checkDecoding (input.ReadVarint32 (&session), "Invalid session");
+          hasSession = true;
+        }
+      else
+        skipField (input, tag);
+    }
+  checkDecoding (input.ConsumedEntireMessage () && hasSeq && hasSession, "Invalid SeqNo");
+
+  input.PopLimit (limit);
+  return SeqNo (session, seq);
+}
+
+// decode one SyncState, the name is read in-place from the input buffer whenever possible
+static void
+parseSyncState (CodedInputStream &input, string &nameBuffer, StateVisitor &visitor)
+{
+  uint32_t length = 0;
+  checkDecoding (input.ReadVarint32 (&length), "Invalid SyncState length");
+  CodedInputStream::Limit limit = input.PushLimit (length);
+
+  const char *name = 0;
+  uint32_t nameLength = 0;
+  uint32_t type = 0;
+  bool hasType = false;
+  SeqNo seqNo (0, 0);
+  while (uint32_t tag = input.ReadTag ())
+    {
+      if (tag == SS_NAME_TAG)
+        {
+          checkDecoding (input.ReadVarint32 (&nameLength), "Invalid name length");
+
+          const void *data = 0;
+          int size = 0;
+          if (input.GetDirectBufferPointer (&data, &size) && static_cast<uint32_t> (size) >= nameLength)
+            {
+              name = static_cast<const char*> (data);
+              input.Skip (nameLength);
+            }
+          else
+            {
+              checkDecoding (input.ReadString (&nameBuffer, nameLength), "Invalid name");
+              name = nameBuffer.c_str ();
+            }
+        }
+      else if (tag == SS_TYPE_TAG)
+        {
+          checkDecoding (input.ReadVarint32 (&type) && type <= SyncState::ActionType_MAX, "Invalid type");
+          hasType = true;
+        }
+      else if (tag == SS_SEQNO_TAG)
+        seqNo = parseSeqNo (input);
+      else
+        skipField (input, tag);
+    }
+  checkDecoding (input.ConsumedEntireMessage () && name != 0 && hasType, "Invalid SyncState");
+
+  input.PopLimit (limit);
+
+  NameInfoConstPtr info = StdNameInfo::FindOrCreate (name, nameLength);
+  if (type == SyncState::UPDATE)
+    visitor.visitUpdate (info, seqNo);
+  else
+    visitor.visitRemove (info);
+}
+
+static void
+parseProtobufState (const char *wireData, size_t len, StateVisitor &visitor)
+{
+  CodedInputStream input (reinterpret_cast<const uint8_t*> (wireData), len);
+
+  string nameBuffer;
+  while (uint32_t tag = input.ReadTag ())
+    {
+      if (tag == MSG_SS_TAG)
+        parseSyncState (input, nameBuffer, visitor);
+      else
+        skipField (input, tag);
+    }
+  checkDecoding (input.ConsumedEntireMessage (), "Invalid SyncStateMsg");
+}
+
+void
+decodeState (const char *wireData, size_t len, StateVisitor &visitor)
+{
+  if (len > 0 && static_cast<unsigned char> (wireData[0]) == COMPACT_WIRE_FORMAT_V1)
+    parseCompactState (wireData, len, visitor);
+  else
+    parseProtobufState (wireData, len, visitor);
+}
+
+/**
+ * @brief Visitor that applies decoded leaves to the state
+ */
+class StateUpdater : public StateVisitor
+{
+public:
+  StateUpdater (State &state) : m_state (state) { }
+
+  virtual void
+  visitUpdate (const NameInfoConstPtr &info, const SeqNo &seq) { m_state.update (info, seq); }
+
+  virtual void
+  visitRemove (const NameInfoConstPtr &info) { m_state.remove (info); }
+
+private:
+  State &m_state;
+};
+
+void
+decodeState (const char *wireData, size_t len, State &state)
+{
+  StateUpdater updater (state);
+  decodeState (wireData, len, updater);
+}
+
 }
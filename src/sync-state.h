@@ -51,7 +51,10 @@ typedef boost::shared_ptr<State> StateConstPtr;
 
 /**
  * \ingroup sync
- * @brief Container for state leaves and definition of the abstract interface to work with State objects
+ * @brief Definition of the abstract interface to work with State objects
+ *
+ * Leaves are kept by the derived classes (FullState, DiffState) in containers
+ * of the specific leaf type, so they can be accessed without casts
  */
 class State
 {
@@ -73,28 +76,29 @@ public:
    */
   virtual bool
   remove (NameInfoConstPtr info) = 0;
-
-  /**
-   * @brief Get state leaves
-   */
-  const LeafContainer &
-  getLeaves () const 
-  { return m_leaves; }
-  
-protected:
-  LeafContainer m_leaves;
 };
 
 
 /**
- * @brief Formats a protobuf SyncStateMsg msg
- * @param oss output SyncStateMsg msg
- * @param state state
- * @returns output SyncStateMsg msg
+ * \ingroup sync
+ * @brief Encodings of the state in Sync Data packets
+ *
+ * Receivers detect the encoding from the first byte, so a SyncLogic using
+ * COMPACT_WIRE_FORMAT can talk to any peer that understands it, while
+ * PROTOBUF_WIRE_FORMAT (the default) is understood by all versions
  */
-SyncStateMsg &
-operator << (SyncStateMsg &ossm, const State &state);
+enum WireFormat
+  {
+    PROTOBUF_WIRE_FORMAT, ///< @brief protobuf SyncStateMsg
+    COMPACT_WIRE_FORMAT   ///< @brief sorted leaves with front-coded names and varint-coded sequence numbers
+  };
 
+/**
+ * @brief First byte of the compact encoding (version 1)
+ *
+ * A non-empty protobuf SyncStateMsg always starts with 0x0a (field 1, length-delimited)
+ */
+const unsigned char COMPACT_WIRE_FORMAT_V1 = 0xc1;
 
 /**
  * @brief Parse a protobuf SyncStateMsg msg
@@ -105,6 +109,51 @@ operator << (SyncStateMsg &ossm, const State &state);
 SyncStateMsg &
 operator >> (SyncStateMsg &issm, State &state);
 
+/**
+ * \ingroup sync
+ * @brief Receiver of leaves decoded from a Sync Data packet (see decodeState)
+ */
+class StateVisitor
+{
+public:
+  virtual ~StateVisitor () { };
+
+  /**
+   * @brief Called for every updated leaf, in the order of the packet
+   */
+  virtual void
+  visitUpdate (const NameInfoConstPtr &info, const SeqNo &seq) = 0;
+
+  /**
+   * @brief Called for every removed leaf, in the order of the packet
+   */
+  virtual void
+  visitRemove (const NameInfoConstPtr &info) = 0;
+};
+
+/**
+ * @brief Decode leaves of a Sync Data packet in any of the supported wire formats
+ * @param wireData content of the packet
+ * @param len length of the content
+ * @param visitor receiver of the leaves
+ *
+ * The packet is decoded in one pass directly from wireData, without creating
+ * a SyncStateMsg or any other intermediate copy of the state.  Throws
+ * Error::SyncStateMsgDecodingFailure if the content cannot be decoded (the
+ * visitor may have received some of the leaves in this case)
+ */
+void
+decodeState (const char *wireData, size_t len, StateVisitor &visitor);
+
+/**
+ * @brief Decode leaves of a Sync Data packet and apply them to the state
+ *
+ * The same as decodeState (wireData, len, visitor) with a visitor that
+ * calls update () and remove () of the state
+ */
+void
+decodeState (const char *wireData, size_t len, State &state);
+
 namespace Error {
 /**
  * @brief Will be thrown when data cannot be properly decoded to SyncStateMsg
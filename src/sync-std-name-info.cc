@@ -21,7 +21,6 @@
  */
 
 #include "sync-std-name-info.h"
-#include "boost/thread/locks.hpp"
 
 using namespace std;
 using namespace boost;
@@ -29,69 +28,54 @@ using namespace boost;
 namespace Sync {
 
 
+NameTable StdNameInfo::m_names;
+
 NameInfoConstPtr
 StdNameInfo::FindOrCreate (const std::string &key)
 {
-  mutex::scoped_lock namesLock (m_namesMutex);
-  
-  // std::cout << "FindOrCreate: " << m_names.size () << "\n";
-  
-  NameInfoConstPtr ret;
-  
-  NameMap::iterator item = m_names.find (key);
-  if (item != m_names.end ())
-    {
-      ret = item->second.lock ();
-      BOOST_ASSERT (ret != 0);
-    }
-  else
-    {
-      ret = NameInfoPtr (new StdNameInfo (key));
-      weak_ptr<const NameInfo> value (ret);
-      pair<NameMap::iterator,bool> inserted =
-        m_names.insert (make_pair (key, value));
-      
-      BOOST_ASSERT (inserted.second); // previous call has to insert value
-      item = inserted.first;
-    }
+  return m_names.findOrInsert (key.c_str (), key.size (), &StdNameInfo::Create);
+}
 
-  return ret;
+NameInfoConstPtr
+StdNameInfo::FindOrCreate (const char *name, size_t length)
+{
+  return m_names.findOrInsert (name, length, &StdNameInfo::Create);
 }
 
-StdNameInfo::StdNameInfo (const std::string &name)
-  : m_name (name)
+NameInfo *
+StdNameInfo::Create (NameTable::NodeId node, const char *name, size_t length)
 {
-  m_id = m_ids ++; // set ID for a newly inserted element
-  m_digest << name;
-  m_digest.finalize ();
+  return new StdNameInfo (node, name, length);
+}
 
-  // std::cout << "StdNameInfo: " << name << " = " << m_id << "\n";
+StdNameInfo::StdNameInfo (NameTable::NodeId node, const char *name, size_t length)
+  : m_node (node)
+{
+  m_digest = Digest::hash (name, length);
+  m_id = m_digest.getHash (); // names are not ordered by ID, so any well-mixed value will do
 }
 
 StdNameInfo::~StdNameInfo ()
 {
-  mutex::scoped_lock namesLock (m_namesMutex);
-
-  // cout << "Destructor for " << m_name << "\n";
-  m_names.erase (toString ());
+  m_names.erase (m_node);
 }
 
 string
 StdNameInfo::toString () const
 {
-  return m_name;
+  return m_names.toString (m_node);
 }
 
 bool
 StdNameInfo::operator == (const NameInfo &info) const
 {
-  return m_name == dynamic_cast<const StdNameInfo&> (info).m_name;
+  return m_node == dynamic_cast<const StdNameInfo&> (info).m_node;
 }
 
 bool
 StdNameInfo::operator < (const NameInfo &info) const
 {
-  return m_name < dynamic_cast<const StdNameInfo&> (info).m_name;
+  return m_names.compare (m_node, dynamic_cast<const StdNameInfo&> (info).m_node) < 0;
 }
 
 } // Sync
@@ -24,6 +24,7 @@
 #define SYNC_STD_NAME_INFO_H
 
 #include "sync-name-info.h"
+#include "sync-name-table.h"
 #include <string>
 
 namespace Sync {
@@ -39,7 +40,18 @@ public:
   FindOrCreate (const std::string &name);
 
   /**
-   * @brief Destructor which will clean up m_names structure
+   * @brief Lookup existing or create new NameInfo object
+   * @param name pointer to characters of routable prefix (does not need to be null-terminated)
+   * @param length number of characters
+   *
+   * The same as FindOrCreate (const std::string &), but does not create a
+   * temporary string if the name already exists
+   */
+  static NameInfoConstPtr
+  FindOrCreate (const char *name, size_t length);
+
+  /**
+   * @brief Destructor which will clean up m_names table
    */
   virtual ~StdNameInfo ();
   
@@ -64,9 +76,14 @@ private:
    */
   StdNameInfo () {}
   StdNameInfo& operator = (const StdNameInfo &info) { (void)info; return *this; }
-  StdNameInfo (const std::string &name);
+  StdNameInfo (NameTable::NodeId node, const char *name, size_t length);
+
+  static NameInfo *
+  Create (NameTable::NodeId node, const char *name, size_t length);
   
-  std::string m_name;
+  NameTable::NodeId m_node; ///< @brief node of the name in m_names trie (the name itself is stored only there)
+
+  static NameTable m_names;
 };
 
 } // Sync
@@ -0,0 +1,101 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Zhenkai Zhu <zhenkai@cs.ucla.edu>
+ *         Chaoyi Bian <bcy@pku.edu.cn>
+ *	   Alexander Afanasyev <alexander.afanasyev@ucla.edu>
+ */
+
+#ifndef SYNC_THREADING_POLICY_H
+#define SYNC_THREADING_POLICY_H
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/recursive_mutex.hpp>
+
+namespace Sync {
+
+/**
+ * @ingroup sync
+ * @brief Mutex that does nothing (for single-threaded mode)
+ */
+class NullMutex
+{
+public:
+  void
+  lock () { }
+
+  void
+  unlock () { }
+
+  bool
+  try_lock () { return true; }
+
+  /**
+   * @brief The same interface as boost::mutex::scoped_lock
+   */
+  class scoped_lock
+  {
+  public:
+    explicit
+    scoped_lock (NullMutex &) { }
+
+    void
+    lock () { }
+
+    void
+    unlock () { }
+  };
+};
+
+/**
+ * @ingroup sync
+ * @brief Threading policy when all calls are made from one thread (e.g., ns-3 simulator thread)
+ */
+struct SingleThreaded
+{
+  typedef NullMutex Mutex;
+  typedef NullMutex RecursiveMutex;
+};
+
+/**
+ * @ingroup sync
+ * @brief Threading policy when the library is used from several threads
+ */
+struct MultiThreaded
+{
+  typedef boost::mutex Mutex;
+  typedef boost::recursive_mutex RecursiveMutex;
+};
+
+/**
+ * @ingroup sync
+ * @brief Threading policy of SyncLogic, SyncInterestTable, NameTable and ObjectPool
+ *
+ * The policy changes layout of these classes, so it is selected only by
+ * SYNC_SINGLE_THREADED, which is set by "./waf configure" (unless
+ * --multi-threaded is given) and exported to library users through
+ * pkg-config, in the same way as FLAT_LEAF_CONTAINER
+ */
+#ifdef SYNC_SINGLE_THREADED
+typedef SingleThreaded ThreadingPolicy;
+#else
+typedef MultiThreaded ThreadingPolicy;
+#endif
+
+} // Sync
+
+#endif // SYNC_THREADING_POLICY_H
@@ -26,8 +26,13 @@
 using boost::test_tools::output_test_stream;
 
 #include "sync-digest.h"
+#include "sync-digest-engine.h"
+#include "sync-hex.h"
 #include <iostream>
 #include <sstream>
+#include <string.h>
+#include <stdio.h>
+#include <algorithm>
 
 using namespace Sync;
 using namespace Sync::Error;
@@ -102,4 +107,188 @@ BOOST_AUTO_TEST_CASE (DigestComparison)
   BOOST_CHECK (d4 != d3);
 }
 
+BOOST_AUTO_TEST_CASE (DigestValueTest)
+{
+  DigestValue v0;
+  BOOST_CHECK (v0.empty ());
+  BOOST_CHECK_THROW (v0.isZero (), DigestCalculationError);
+
+  Digest d1;
+  d1 << "1\n";
+  BOOST_CHECK_THROW (d1.getValue (), DigestCalculationError);
+  d1.finalize ();
+
+  DigestValue v1 = d1.getValue ();
+  BOOST_CHECK_EQUAL (v1.size (), 32);
+  BOOST_CHECK (v1 == d1.getValue ());
+  BOOST_CHECK_EQUAL (v1.getHash (), d1.getHash ());
+
+  // plain memory copy produces the same value
+  DigestValue v2;
+  memcpy (&v2, &v1, sizeof (DigestValue));
+  BOOST_CHECK (v2 == v1);
+
+  output_test_stream output;
+  output << v2;
+  BOOST_CHECK (output.is_equal ("4355a46b19d348dc2f57c046f8ef63d4538ebb936000f3c9ee954a27460dd865", true));
+
+  DigestValue v3;
+  istringstream is ("00");
+  BOOST_CHECK_NO_THROW (is >> v3);
+  BOOST_CHECK (v3.isZero ());
+  BOOST_CHECK (v3 != v1);
+
+  Digest d2;
+  d2 << v1;
+  d2.finalize ();
+  Digest d3;
+  d3 << d1;
+  d3.finalize ();
+  BOOST_CHECK (d2 == d3);
+}
+
+BOOST_AUTO_TEST_CASE (OneShotHashTest)
+{
+  Digest d1;
+  d1 << "1\n";
+  d1.finalize ();
+  BOOST_CHECK (Digest::hash ("1\n", 2) == d1.getValue ());
+  BOOST_CHECK (Digest::hash ("1", 1, "\n", 1) == d1.getValue ());
+  BOOST_CHECK (Digest::hash ("", 0, "1", 1, "\n", 1) == d1.getValue ());
+
+  // contexts are reused by subsequent Digest objects
+  for (int i = 0; i < 100; i++)
+    {
+      Digest d2;
+      d2 << "1\n";
+      d2.finalize ();
+      BOOST_CHECK (d2 == d1);
+    }
+}
+
+template<class Engine>
+static DigestValue
+engineHash (Engine &engine, const uint8_t *buffer, size_t size, size_t chunk)
+{
+  BOOST_CHECK (engine.init ());
+  for (size_t offset = 0; offset < size; offset += chunk)
+    BOOST_CHECK (engine.update (buffer + offset, std::min (chunk, size - offset)));
+
+  uint8_t digest[MAX_DIGEST_SIZE];
+  uint32_t length = 0;
+  BOOST_CHECK (engine.finalize (digest, length));
+  return DigestValue (digest, length);
+}
+
+BOOST_AUTO_TEST_CASE (DigestEngineTest)
+{
+  uint8_t buffer[300];
+  for (size_t i = 0; i < sizeof (buffer); i++)
+    buffer[i] = static_cast<uint8_t> (i * 7 + 3);
+
+  OpensslSha256Engine openssl;
+  Sha256Engine portable (false);
+  Sha256Engine accelerated (true);
+  FastHashEngine fast;
+
+  DigestValue previousFast;
+  for (size_t size = 0; size <= sizeof (buffer); size++)
+    {
+      DigestValue reference = engineHash (openssl, buffer, size, sizeof (buffer));
+      BOOST_CHECK_EQUAL (reference.size (), 32);
+
+      BOOST_CHECK (engineHash (portable, buffer, size, sizeof (buffer)) == reference);
+      BOOST_CHECK (engineHash (portable, buffer, size, 13) == reference);
+      BOOST_CHECK (engineHash (accelerated, buffer, size, sizeof (buffer)) == reference);
+      BOOST_CHECK (engineHash (accelerated, buffer, size, 13) == reference);
+
+      DigestValue fastValue = engineHash (fast, buffer, size, sizeof (buffer));
+      BOOST_CHECK_EQUAL (fastValue.size (), 32);
+      BOOST_CHECK (engineHash (fast, buffer, size, 13) == fastValue);
+      BOOST_CHECK (fastValue != reference);
+      if (!previousFast.empty ())
+        BOOST_CHECK (fastValue != previousFast);
+      previousFast = fastValue;
+    }
+}
+
+BOOST_AUTO_TEST_CASE (HashBatchTest)
+{
+  uint8_t data[20][200];
+  const uint8_t *buffers[20];
+  for (size_t i = 0; i < 20; i++)
+    {
+      for (size_t j = 0; j < 200; j++)
+        data[i][j] = static_cast<uint8_t> (i * 31 + j * 17);
+      buffers[i] = data[i];
+    }
+
+  size_t sizes[] = { 0, 1, 8, 55, 56, 63, 64, 65, 119, 120, 128, 200 };
+  for (size_t s = 0; s < sizeof (sizes) / sizeof (sizes[0]); s++)
+    for (size_t count = 0; count <= 20; count += 3)
+      {
+        DigestValue values[20];
+        Digest::hashBatch (buffers, sizes[s], count, values);
+        for (size_t i = 0; i < count; i++)
+          BOOST_CHECK (values[i] == Digest::hash (buffers[i], sizes[s]));
+      }
+}
+
+BOOST_AUTO_TEST_CASE (HexTest)
+{
+  uint8_t data[100];
+  for (size_t i = 0; i < sizeof (data); i++)
+    data[i] = static_cast<uint8_t> (i * 37 + 11);
+
+  for (size_t size = 0; size <= sizeof (data); size++)
+    {
+      string reference;
+      for (size_t i = 0; i < size; i++)
+        {
+          char byte[3];
+          snprintf (byte, sizeof (byte), "%02x", data[i]);
+          reference += byte;
+        }
+
+      char hex[2 * sizeof (data)];
+      hexEncode (data, size, hex);
+      BOOST_CHECK_EQUAL (string (hex, 2 * size), reference);
+
+      uint8_t decoded[sizeof (data)];
+      BOOST_CHECK (hexDecode (reference.c_str (), reference.size (), decoded));
+      BOOST_CHECK (memcmp (decoded, data, size) == 0);
+
+      // upper case is accepted too
+      for (size_t i = 0; i < reference.size (); i++)
+        reference[i] = toupper (reference[i]);
+      memset (decoded, 0, sizeof (decoded));
+      BOOST_CHECK (hexDecode (reference.c_str (), reference.size (), decoded));
+      BOOST_CHECK (memcmp (decoded, data, size) == 0);
+
+      // any invalid character is detected (both in vectorized part and in the tail)
+      for (size_t i = 0; i < reference.size (); i++)
+        {
+          string broken = reference;
+          broken[i] = (i % 3 == 0) ? 'g' : ((i % 3 == 1) ? '/' : '\xb0');
+          BOOST_CHECK (!hexDecode (broken.c_str (), broken.size (), decoded));
+        }
+    }
+
+  BOOST_CHECK (!hexDecode ("abc", 3, data));
+
+  Digest d1;
+  d1 << "1\n";
+  d1.finalize ();
+
+  string str = "prefix/";
+  d1.getValue ().appendHex (str);
+  BOOST_CHECK_EQUAL (str, "prefix/4355a46b19d348dc2f57c046f8ef63d4538ebb936000f3c9ee954a27460dd865");
+  BOOST_CHECK (DigestValue::fromHex (str.c_str () + 7, str.size () - 7) == d1.getValue ());
+  BOOST_CHECK (DigestValue::fromHex ("00", 2).isZero ());
+  BOOST_CHECK_THROW (DigestValue::fromHex ("", 0), DigestCalculationError);
+  BOOST_CHECK_THROW (DigestValue::fromHex ("0", 1), DigestCalculationError);
+  BOOST_CHECK_THROW (DigestValue::fromHex ("zz", 2), DigestCalculationError);
+  BOOST_CHECK_THROW (DigestValue::fromHex (str.c_str (), str.size ()), DigestCalculationError);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -25,6 +25,8 @@
 using boost::test_tools::output_test_stream;
 
 #include <boost/make_shared.hpp>
+#include <boost/lexical_cast.hpp>
+#include <string.h>
 
 #include "sync-full-leaf.h"
 #include "sync-diff-leaf.h"
@@ -70,6 +72,55 @@ BOOST_AUTO_TEST_CASE (LeafBase)
   BOOST_CHECK_EQUAL (name.use_count (), 4);
 }
 
+BOOST_AUTO_TEST_CASE (NameInterning)
+{
+  const char buffer[] = "/test/interned/name-and-garbage";
+  size_t length = strlen ("/test/interned/name");
+
+  NameInfoConstPtr name = StdNameInfo::FindOrCreate (buffer, length);
+  BOOST_CHECK_EQUAL (name->toString (), "/test/interned/name");
+  BOOST_CHECK (name.get () == StdNameInfo::FindOrCreate ("/test/interned/name").get ());
+  BOOST_CHECK (name.get () != StdNameInfo::FindOrCreate (buffer, length - 1).get ());
+
+  // name is removed from the table with the last reference and can be created again
+  name.reset ();
+  name = StdNameInfo::FindOrCreate (buffer, length);
+  BOOST_CHECK_EQUAL (name->toString (), "/test/interned/name");
+  BOOST_CHECK_EQUAL (name.use_count (), 1);
+
+  vector<NameInfoConstPtr> names;
+  for (int i = 0; i < 100; i++)
+    names.push_back (StdNameInfo::FindOrCreate ("/test/interned/" + lexical_cast<string> (i)));
+  for (int i = 0; i < 100; i++)
+    {
+      string key = "/test/interned/" + lexical_cast<string> (i);
+      BOOST_CHECK (names[i].get () == StdNameInfo::FindOrCreate (key.c_str (), key.size ()).get ());
+    }
+}
+
+BOOST_AUTO_TEST_CASE (NameOrder)
+{
+  // names share prefixes in the trie, but must be ordered as strings
+  const char *keys[] = { "", "/", "a", "/a", "/a/b", "/a/b/c", "/a-b", "/a-b/c", "/ab",
+                         "/a//b", "/a/", "/b", "ab/x", "abc", "/a/b0", "/a/b/" };
+  size_t count = sizeof (keys) / sizeof (keys[0]);
+
+  vector<NameInfoConstPtr> names;
+  for (size_t i = 0; i < count; i++)
+    {
+      names.push_back (StdNameInfo::FindOrCreate (keys[i]));
+      BOOST_CHECK_EQUAL (names[i]->toString (), keys[i]);
+    }
+
+  for (size_t i = 0; i < count; i++)
+    for (size_t j = 0; j < count; j++)
+      {
+        BOOST_CHECK_MESSAGE ((*names[i] < *names[j]) == (string (keys[i]) < string (keys[j])),
+                             "\"" << keys[i] << "\" < \"" << keys[j] << "\"");
+        BOOST_CHECK_EQUAL (*names[i] == *names[j], i == j);
+      }
+}
+
 BOOST_AUTO_TEST_CASE (LeafDigest)
 {
   BOOST_CHECK_EQUAL (StdNameInfo::FindOrCreate ("/test/name").use_count (), 1);
@@ -105,4 +156,36 @@ BOOST_AUTO_TEST_CASE (LeafDigest)
 	BOOST_CHECK (output.is_equal ("39fefe65b3e1021776c07d3a9a3023c6c7cdf12724ee7f3a98b813b22f46d5ec", true)); // for sha256
 }
 
+BOOST_AUTO_TEST_CASE (SeqNoDigest)
+{
+  SeqNo seq (1, 12);
+  Digest manual;
+  manual << 1 << 12;
+  manual.finalize ();
+  BOOST_CHECK (seq.getDigest () == manual.getValue ());
+
+  // digest follows sequence number changes
+  ++seq;
+  BOOST_CHECK (seq.getDigest () == SeqNo (1, 13).getDigest ());
+  seq.setSeq (20);
+  BOOST_CHECK (seq.getDigest () == SeqNo (1, 20).getDigest ());
+
+  SeqNo copy (seq);
+  BOOST_CHECK (copy.getDigest () == seq.getDigest ());
+  copy = SeqNo (2, 20);
+  BOOST_CHECK (copy.getDigest () != seq.getDigest ());
+
+  NameInfoConstPtr name = StdNameInfo::FindOrCreate ("/test/name");
+  FullLeaf fullLeaf (name, SeqNo (13));
+  DigestValue digest = fullLeaf.getDigest ();
+
+  // older sequence number does not change the leaf
+  fullLeaf.setSeq (SeqNo (12));
+  BOOST_CHECK_EQUAL (fullLeaf.getSeq ().getSeq (), 13);
+  BOOST_CHECK (fullLeaf.getDigest () == digest);
+
+  fullLeaf.setSeq (SeqNo (14));
+  BOOST_CHECK (fullLeaf.getDigest () == FullLeaf (name, SeqNo (14)).getDigest ());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
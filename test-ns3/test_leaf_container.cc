@@ -0,0 +1,116 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Zhenkai Zhu <zhenkai@cs.ucla.edu>
+ *         Chaoyi Bian <bcy@pku.edu.cn>
+ *	   Alexander Afanasyev <alexander.afanasyev@ucla.edu>
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/foreach.hpp>
+#include <boost/bind.hpp>
+
+#include "sync-state-leaf-container.h"
+#include "sync-full-leaf.h"
+#include "sync-std-name-info.h"
+
+#include <map>
+#include <vector>
+#include <stdlib.h>
+
+using namespace Sync;
+using namespace std;
+using namespace boost;
+
+BOOST_AUTO_TEST_SUITE(LeafContainerTests)
+
+static void
+checkContainer (const FlatLeafContainer<FullLeaf> &container, const map<string, uint32_t> &reference)
+{
+  BOOST_REQUIRE_EQUAL (container.size (), reference.size ());
+
+  // ordered view
+  map<string, uint32_t>::const_iterator expected = reference.begin ();
+  BOOST_FOREACH (const FullLeafPtr &leaf, container.get<ordered> ())
+    {
+      BOOST_CHECK_EQUAL (leaf->getInfo ()->toString (), expected->first);
+      BOOST_CHECK_EQUAL (leaf->getSeq ().getSeq (), expected->second);
+      expected ++;
+    }
+
+  // lookups
+  for (expected = reference.begin (); expected != reference.end (); expected++)
+    {
+      FlatLeafContainer<FullLeaf>::iterator item = container.find (StdNameInfo::FindOrCreate (expected->first));
+      BOOST_REQUIRE (item != container.end ());
+      BOOST_CHECK_EQUAL ((*item)->getSeq ().getSeq (), expected->second);
+    }
+}
+
+BOOST_AUTO_TEST_CASE (FlatLeafContainerTest)
+{
+  vector<NameInfoConstPtr> names;
+  for (int i = 0; i < 200; i++)
+    names.push_back (StdNameInfo::FindOrCreate ("/container/" + lexical_cast<string> (i)));
+
+  FlatLeafContainer<FullLeaf> container;
+  map<string, uint32_t> reference;
+  BOOST_CHECK (container.find (names[0]) == container.end ());
+
+  srand (1);
+  for (int step = 0; step < 5000; step++)
+    {
+      NameInfoConstPtr name = names[rand () % names.size ()];
+      uint32_t seq = rand () % 1000;
+
+      switch (rand () % 3)
+        {
+        case 0:
+          {
+            bool inserted = container.insert (make_shared<FullLeaf> (name, SeqNo (seq))).second;
+            BOOST_CHECK_EQUAL (inserted, reference.insert (make_pair (name->toString (), seq)).second);
+            break;
+          }
+        case 1:
+          {
+            FlatLeafContainer<FullLeaf>::iterator item = container.find (name);
+            BOOST_CHECK_EQUAL (item != container.end (), reference.count (name->toString ()) > 0);
+            if (item != container.end ())
+              {
+                container.modify (item, bind (&Leaf::setSeq, _1, SeqNo (seq)));
+                reference[name->toString ()] = max (reference[name->toString ()], seq);
+              }
+            break;
+          }
+        case 2:
+          BOOST_CHECK_EQUAL (container.erase (name), reference.erase (name->toString ()));
+          break;
+        }
+
+      if (step % 250 == 0)
+        checkContainer (container, reference);
+    }
+  checkContainer (container, reference);
+
+  container.clear ();
+  BOOST_CHECK (container.empty ());
+  BOOST_CHECK (container.find (names[0]) == container.end ());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
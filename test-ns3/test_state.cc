@@ -0,0 +1,462 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2012 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Zhenkai Zhu <zhenkai@cs.ucla.edu>
+ *         Chaoyi Bian <bcy@pku.edu.cn>
+ *	   Alexander Afanasyev <alexander.afanasyev@ucla.edu>
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/output_test_stream.hpp> 
+using boost::test_tools::output_test_stream;
+
+#include "sync-full-state.h"
+#include "sync-diff-state.h"
+#include "sync-change-index.h"
+#include "sync-diff-history.h"
+#include "sync-std-name-info.h"
+#include "sync-full-leaf.h"
+
+#include <boost/lexical_cast.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/foreach.hpp>
+
+#include <stdlib.h>
+
+using namespace Sync;
+using namespace std;
+using namespace boost;
+
+BOOST_AUTO_TEST_SUITE(StateTests)
+
+BOOST_AUTO_TEST_CASE (IncrementalDigest)
+{
+  NameInfoConstPtr name1 = StdNameInfo::FindOrCreate ("/test/name1");
+  NameInfoConstPtr name2 = StdNameInfo::FindOrCreate ("/test/name2");
+
+  FullState state1 (FullState::INCREMENTAL_DIGEST);
+  BOOST_CHECK (state1.getDigest ().isZero ());
+
+  state1.update (name1, SeqNo (1));
+  DigestValue digest1 = state1.getDigest ();
+  BOOST_CHECK (!digest1.isZero ());
+
+  state1.update (name2, SeqNo (5));
+  state1.update (name1, SeqNo (7));
+
+  // the same leaves added in a different order
+  FullState state2 (FullState::INCREMENTAL_DIGEST);
+  state2.update (name1, SeqNo (7));
+  state2.update (name2, SeqNo (5));
+  BOOST_CHECK (state1.getDigest () == state2.getDigest ());
+
+  // removal takes leaf contribution out of the sum
+  state2.remove (name2);
+  state2.update (name1, SeqNo (1));
+  BOOST_CHECK (state2.getDigest () != state1.getDigest ());
+
+  FullState state3 (FullState::INCREMENTAL_DIGEST);
+  state3.update (name1, SeqNo (7));
+  BOOST_CHECK (state2.getDigest () == state3.getDigest ());
+
+  state3.remove (name1);
+  BOOST_CHECK (state3.getDigest ().isZero ());
+
+  // switching mode recalculates the digest
+  FullState state4;
+  state4.update (name1, SeqNo (7));
+  state4.update (name2, SeqNo (5));
+  BOOST_CHECK (state4.getDigest () != state1.getDigest ());
+
+  state4.setDigestMode (FullState::INCREMENTAL_DIGEST);
+  BOOST_CHECK (state4.getDigest () == state1.getDigest ());
+}
+
+BOOST_AUTO_TEST_CASE (MerkleDigest)
+{
+  vector<NameInfoConstPtr> names;
+  for (int i = 0; i < 100; i++)
+    names.push_back (StdNameInfo::FindOrCreate ("/test/merkle/" + lexical_cast<string> (i)));
+
+  FullState state1 (FullState::MERKLE_DIGEST);
+  BOOST_CHECK (state1.getDigest ().isZero ());
+  for (size_t i = 0; i < names.size (); i++)
+    state1.update (names[i], SeqNo (i));
+
+  // the same leaves added in reverse order, with some intermediate updates and removals
+  FullState state2 (FullState::MERKLE_DIGEST);
+  for (size_t i = names.size (); i > 0; i--)
+    state2.update (names[i-1], SeqNo (0));
+  for (size_t i = 0; i < names.size (); i++)
+    state2.update (names[i], SeqNo (i));
+  state2.remove (names[10]);
+  state2.remove (names[50]);
+  BOOST_CHECK_EQUAL (state2.getMerkleTree ().size (), names.size () - 2);
+  BOOST_CHECK (state1.getDigest () != state2.getDigest ());
+
+  state2.update (names[50], SeqNo (50));
+  state2.update (names[10], SeqNo (10));
+  BOOST_CHECK (state1.getDigest () == state2.getDigest ());
+  BOOST_CHECK (state1.getMerkleTree ().getRoot ()->getDigest () == state2.getMerkleTree ().getRoot ()->getDigest ());
+  BOOST_CHECK_EQUAL (state1.getMerkleTree ().getRoot ()->size (), names.size ());
+
+  // only one of the subtrees below root should differ after a single update
+  state2.update (names[42], SeqNo (1000));
+  const MerkleTree::Node *root1 = state1.getMerkleTree ().getRoot ();
+  const MerkleTree::Node *root2 = state2.getMerkleTree ().getRoot ();
+  BOOST_CHECK (root1->getDigest () != root2->getDigest ());
+  BOOST_REQUIRE (root1->getLeft () != 0 && root1->getRight () != 0);
+  BOOST_CHECK ((root1->getLeft ()->getDigest () == root2->getLeft ()->getDigest ()) !=
+               (root1->getRight ()->getDigest () == root2->getRight ()->getDigest ()));
+
+  // switching mode builds the same tree
+  FullState state3;
+  for (size_t i = 0; i < names.size (); i++)
+    state3.update (names[i], SeqNo (i));
+  state3.setDigestMode (FullState::MERKLE_DIGEST);
+  BOOST_CHECK (state1.getDigest () == state3.getDigest ());
+
+  // root digest is sent to other peers, so the tree shape and node hashing must not depend on the platform
+  output_test_stream output;
+  output << state1.getDigest ();
+  BOOST_CHECK (output.is_equal ("497510392edba26222062adec8931727cf5bb8fe318ebf9d1a6d28c62935259d", true));
+
+  for (size_t i = 0; i < names.size (); i++)
+    state3.remove (names[i]);
+  BOOST_CHECK (state3.getDigest ().isZero ());
+  BOOST_CHECK (state3.getMerkleTree ().getRoot () == 0);
+}
+
+BOOST_AUTO_TEST_CASE (UpdateBatch)
+{
+  FullState::DigestMode modes[] = { FullState::ORDERED_DIGEST, FullState::INCREMENTAL_DIGEST, FullState::MERKLE_DIGEST };
+  for (size_t mode = 0; mode < sizeof (modes) / sizeof (modes[0]); mode++)
+    {
+      FullState sequential (modes[mode]);
+      FullState batch (modes[mode]);
+
+      for (int i = 0; i < 10; i++)
+        {
+          NameInfoConstPtr name = StdNameInfo::FindOrCreate ("/batch/" + lexical_cast<string> (i));
+          sequential.update (name, SeqNo (i, 5));
+          batch.update (name, SeqNo (i, 5));
+        }
+
+      // new names, updates, old and duplicate sequence numbers, repeated names
+      vector<NameInfoConstPtr> infos;
+      vector<SeqNo> seqs;
+      for (int i = 0; i < 57; i++)
+        {
+          infos.push_back (StdNameInfo::FindOrCreate ("/batch/" + lexical_cast<string> (i % 23)));
+          seqs.push_back (SeqNo (i % 23, (i * 7) % 11));
+        }
+
+      vector<boost::tuple<bool, bool, SeqNo> > results;
+      batch.updateBatch (infos, seqs, results);
+      BOOST_REQUIRE_EQUAL (results.size (), infos.size ());
+
+      for (size_t i = 0; i < infos.size (); i++)
+        {
+          bool inserted, updated;
+          SeqNo oldSeq;
+          tie (inserted, updated, oldSeq) = sequential.update (infos[i], seqs[i]);
+
+          BOOST_CHECK_EQUAL (inserted, results[i].get<0> ());
+          BOOST_CHECK_EQUAL (updated, results[i].get<1> ());
+          BOOST_CHECK (oldSeq == results[i].get<2> ());
+        }
+
+      BOOST_CHECK_EQUAL (batch.getLeaves ().size (), sequential.getLeaves ().size ());
+      BOOST_CHECK (batch.getDigest () == sequential.getDigest ());
+    }
+
+  // batch-calculated leaf digests are the same as calculated one by one
+  vector<NameInfoConstPtr> infos;
+  vector<SeqNo> seqs;
+  for (int i = 0; i < 21; i++)
+    {
+      infos.push_back (StdNameInfo::FindOrCreate ("/batch/leaf/" + lexical_cast<string> (i)));
+      seqs.push_back (SeqNo (i * 1000, i));
+    }
+  vector<DigestValue> digests;
+  FullLeaf::calculateDigests (infos, seqs, digests);
+  BOOST_REQUIRE_EQUAL (digests.size (), infos.size ());
+  for (size_t i = 0; i < infos.size (); i++)
+    BOOST_CHECK (digests[i] == FullLeaf (infos[i], seqs[i]).getDigest ());
+}
+
+BOOST_AUTO_TEST_CASE (PooledState)
+{
+  ObjectPoolPtr pool = make_shared<ObjectPool> ();
+  size_t warmSlabs = 0;
+
+  vector<NameInfoConstPtr> names;
+  for (int i = 0; i < 50; i++)
+    names.push_back (StdNameInfo::FindOrCreate ("/pool/" + lexical_cast<string> (i)));
+
+  {
+    FullState pooled (FullState::ORDERED_DIGEST, pool);
+    FullState plain;
+    for (int round = 0; round < 20; round++)
+      {
+        DiffStatePtr diff = allocate_shared<DiffState> (PoolAllocator<DiffState> (pool), pool);
+        for (size_t i = 0; i < names.size (); i++)
+          {
+            pooled.update (names[i], SeqNo (round));
+            plain.update (names[i], SeqNo (round));
+            diff->update (names[i], SeqNo (round));
+          }
+        diff->remove (names[round]);
+        BOOST_CHECK_EQUAL (diff->getLeaves ().size (), names.size ());
+
+        if (round == 1)
+          warmSlabs = pool->getStatistics ().slabs;
+      }
+    BOOST_CHECK (pooled.getDigest () == plain.getDigest ());
+
+    ObjectPool::Statistics stats = pool->getStatistics ();
+    BOOST_CHECK_GT (stats.allocations, 20 * names.size ());
+    // steady churn is served from free lists, no new slabs are requested
+    BOOST_CHECK_EQUAL (stats.slabs, warmSlabs);
+    BOOST_CHECK_GT (stats.bytesInUse, 0);
+  }
+
+  // everything is returned to the pool
+  ObjectPool::Statistics stats = pool->getStatistics ();
+  BOOST_CHECK_EQUAL (stats.allocations, stats.deallocations);
+  BOOST_CHECK_EQUAL (stats.bytesInUse, 0);
+}
+
+static string
+diffToString (const DiffState &diff)
+{
+  ostringstream os;
+  BOOST_FOREACH (const DiffLeafPtr &leaf, diff.getLeaves ().get<ordered> ())
+    {
+      os << leaf->getOperation () << " " << *leaf << "\n";
+    }
+  return os.str ();
+}
+
+static DigestValue
+stepDigest (uint32_t step)
+{
+  uint8_t buffer[DigestValue::MAX_SIZE] = { 0 };
+  for (size_t i = 0; i < sizeof (step); i++)
+    buffer[i] = (step >> (8 * i)) & 0xff;
+
+  return DigestValue (buffer, sizeof (buffer));
+}
+
+BOOST_AUTO_TEST_CASE (ChangeIndexTest)
+{
+  vector<NameInfoConstPtr> names;
+  for (int i = 0; i < 20; i++)
+    names.push_back (StdNameInfo::FindOrCreate ("/changes/" + lexical_cast<string> (i)));
+
+  ChangeIndex index;
+  vector<shared_ptr<DiffState> > diffs;
+
+  srand (2);
+  for (int step = 1; step <= 100; step++)
+    {
+      shared_ptr<DiffState> diff = make_shared<DiffState> ();
+      for (int i = rand () % 3; i >= 0; i--)
+        {
+          if (rand () % 4 == 0)
+            diff->remove (names[rand () % names.size ()]);
+          else
+            diff->update (names[rand () % names.size ()], SeqNo (step));
+        }
+      diffs.push_back (diff);
+      index.record (*diff, step);
+    }
+  BOOST_CHECK_LE (index.size (), names.size ());
+
+  // collected changes are the same as merged diffs
+  for (size_t step = 1; step <= diffs.size (); step++)
+    {
+      DiffState collected;
+      index.collect (step, collected);
+
+      DiffState merged;
+      for (size_t next = step; next < diffs.size (); next++)
+        BOOST_FOREACH (const DiffLeafPtr &leaf, diffs[next]->getLeaves ())
+          {
+            if (leaf->getOperation () == UPDATE)
+              merged.update (leaf->getInfo (), leaf->getSeq ());
+            else
+              merged.remove (leaf->getInfo ());
+          }
+      BOOST_CHECK_EQUAL (diffToString (collected), diffToString (merged));
+    }
+
+  DiffState empty;
+  index.collect (diffs.size (), empty);
+  BOOST_CHECK (empty.getLeaves ().empty ());
+
+  // pruning the changes made at or before the oldest step, which can still be requested
+  size_t bytes = index.getMemoryUsage ();
+  vector<string> expected (diffs.size () + 1);
+  for (size_t step = 90; step <= diffs.size (); step++)
+    {
+      DiffState collected;
+      index.collect (step, collected);
+      expected[step] = diffToString (collected);
+    }
+  index.prune (90);
+  BOOST_CHECK_LT (index.getMemoryUsage (), bytes);
+  BOOST_CHECK_LE (index.size (), 10 * 3);
+  for (size_t step = 90; step <= diffs.size (); step++)
+    {
+      DiffState collected;
+      index.collect (step, collected);
+      BOOST_CHECK_EQUAL (diffToString (collected), expected[step]);
+    }
+
+  index.prune (diffs.size ());
+  BOOST_CHECK_EQUAL (index.size (), 0);
+  BOOST_CHECK_EQUAL (index.getMemoryUsage (), 0);
+}
+
+BOOST_AUTO_TEST_CASE (DiffHistoryTest)
+{
+  DiffHistory history;
+  BOOST_CHECK_EQUAL (history.find (stepDigest (1)), 0);
+
+  // states after steps 31..40 repeat states after steps 1..10
+  for (uint32_t step = 1; step <= 40; step++)
+    BOOST_CHECK_EQUAL (history.push (stepDigest (step <= 30 ? step : step - 30)), step);
+  BOOST_CHECK_EQUAL (history.size (), 40);
+  BOOST_CHECK_EQUAL (history.getLastStep (), 40);
+  BOOST_CHECK_EQUAL (history.find (stepDigest (5)), 35);
+  BOOST_CHECK_EQUAL (history.find (stepDigest (15)), 15);
+
+  size_t bytes = history.getMemoryUsage ();
+  for (int i = 0; i < 20; i++)
+    history.pop ();
+  BOOST_CHECK_EQUAL (history.size (), 20);
+  BOOST_CHECK_EQUAL (history.getFirstStep (), 21);
+  BOOST_CHECK_LT (history.getMemoryUsage (), bytes);
+  BOOST_CHECK_EQUAL (history.find (stepDigest (15)), 0);
+  BOOST_CHECK_EQUAL (history.find (stepDigest (25)), 25);
+  BOOST_CHECK_EQUAL (history.find (stepDigest (5)), 35);
+
+  // buffer is reused after wrap-around
+  for (uint32_t step = 41; step <= 60; step++)
+    history.push (stepDigest (step));
+  BOOST_CHECK_EQUAL (history.find (stepDigest (25)), 25);
+  BOOST_CHECK_EQUAL (history.find (stepDigest (60)), 60);
+
+  while (history.size () > 0)
+    history.pop ();
+  BOOST_CHECK_EQUAL (history.getMemoryUsage (), 0);
+  BOOST_CHECK_EQUAL (history.find (stepDigest (60)), 0);
+}
+
+BOOST_AUTO_TEST_CASE (WireFormats)
+{
+  FullState full;
+  DiffState diff;
+  for (uint32_t i = 0; i < 200; i++)
+    {
+      NameInfoConstPtr name = StdNameInfo::FindOrCreate ("/ndn/edu/ucla/chronochat/user-" + lexical_cast<string> (i));
+      full.update (name, SeqNo (1350000000 + i % 7, i * 13));
+      if (i % 10 == 0)
+        diff.remove (name);
+      else if (i % 10 == 1)
+        diff.update (name, SeqNo (0xffffffff - i, i == 1 ? 0xffffffff : 0));
+    }
+  diff.update (StdNameInfo::FindOrCreate (""), SeqNo (5, 5));
+
+  string protobuf, compact;
+  encodeState (full, PROTOBUF_WIRE_FORMAT, protobuf);
+  encodeState (full, COMPACT_WIRE_FORMAT, compact);
+  BOOST_CHECK_EQUAL (static_cast<unsigned char> (protobuf[0]), 0x0a);
+  BOOST_CHECK_EQUAL (static_cast<unsigned char> (compact[0]), COMPACT_WIRE_FORMAT_V1);
+  BOOST_CHECK_LT (compact.size () * 3, protobuf.size ());
+
+  DiffState fromProtobuf, fromCompact;
+  decodeState (protobuf.c_str (), protobuf.size (), fromProtobuf);
+  decodeState (compact.c_str (), compact.size (), fromCompact);
+  BOOST_CHECK_EQUAL (fromProtobuf.getLeaves ().size (), 200);
+  BOOST_CHECK_EQUAL (diffToString (fromCompact), diffToString (fromProtobuf));
+
+  encodeState (diff, PROTOBUF_WIRE_FORMAT, protobuf);
+  encodeState (diff, COMPACT_WIRE_FORMAT, compact);
+  DiffState diffFromProtobuf, diffFromCompact;
+  decodeState (protobuf.c_str (), protobuf.size (), diffFromProtobuf);
+  decodeState (compact.c_str (), compact.size (), diffFromCompact);
+  BOOST_CHECK_EQUAL (diffToString (diffFromProtobuf), diffToString (diff));
+  BOOST_CHECK_EQUAL (diffToString (diffFromCompact), diffToString (diff));
+
+  // empty state
+  encodeState (DiffState (), COMPACT_WIRE_FORMAT, compact);
+  DiffState empty;
+  decodeState (compact.c_str (), compact.size (), empty);
+  BOOST_CHECK (empty.getLeaves ().empty ());
+
+  // truncated and corrupted data
+  encodeState (full, COMPACT_WIRE_FORMAT, compact);
+  DiffState garbage;
+  BOOST_CHECK_THROW (decodeState (compact.c_str (), compact.size () - 1, garbage), Error::SyncStateMsgDecodingFailure);
+  BOOST_CHECK_THROW (decodeState (compact.c_str (), compact.size () / 2, garbage), Error::SyncStateMsgDecodingFailure);
+  compact[3] = 0x7e; // prefix longer than the previous name
+  BOOST_CHECK_THROW (decodeState (compact.c_str (), compact.size (), garbage), Error::SyncStateMsgDecodingFailure);
+  BOOST_CHECK_THROW (decodeState ("\xc2", 1, garbage), Error::SyncStateMsgDecodingFailure);
+}
+
+BOOST_AUTO_TEST_CASE (StreamingDecoder)
+{
+  SyncStateMsg msg;
+  for (uint32_t i = 0; i < 100; i++)
+    {
+      SyncState *ss = msg.add_ss ();
+      ss->set_name ("/streaming/" + lexical_cast<string> (i));
+      ss->set_type (i % 3 == 0 ? SyncState::UPDATE : (i % 3 == 1 ? SyncState::DELETE : SyncState::OTHER));
+      if (i % 3 == 0 || i % 5 == 0)
+        {
+          ss->mutable_seqno ()->set_session (i * 1000000);
+          ss->mutable_seqno ()->set_seq (i);
+        }
+    }
+  // leaf with the default (empty) seqno
+  msg.add_ss ()->set_name ("/streaming/no-seqno");
+  msg.mutable_ss (100)->set_type (SyncState::UPDATE);
+
+  string wire;
+  msg.SerializeToString (&wire);
+
+  DiffState streamed, parsed;
+  decodeState (wire.c_str (), wire.size (), streamed);
+  SyncStateMsg parsedMsg;
+  BOOST_REQUIRE (parsedMsg.ParseFromString (wire));
+  parsedMsg >> parsed;
+  BOOST_CHECK_EQUAL (streamed.getLeaves ().size (), 101);
+  BOOST_CHECK_EQUAL (diffToString (streamed), diffToString (parsed));
+
+  DiffState garbage;
+  BOOST_CHECK_THROW (decodeState (wire.c_str (), wire.size () - 1, garbage), Error::SyncStateMsgDecodingFailure);
+
+  SyncStateMsg noName;
+  noName.add_ss ()->set_type (SyncState::DELETE);
+  BOOST_CHECK (!noName.IsInitialized ());
+  noName.SerializePartialToString (&wire);
+  BOOST_CHECK_THROW (decodeState (wire.c_str (), wire.size (), garbage), Error::SyncStateMsgDecodingFailure);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
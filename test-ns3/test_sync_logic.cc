@@ -142,6 +142,30 @@ public:
   {
     std::string newDigest = l1->getRootDigest ();
     BOOST_CHECK_EQUAL (oldDigest, newDigest);
+
+    Simulator::Schedule (Seconds (1), &SyncLogicFixture::step6, this);
+  }
+
+  void
+  step6 ()
+  {
+    vector<LocalNameUpdate> updates (3);
+    updates[0].prefix = "/two";   updates[0].session = 1; updates[0].seq = 5;
+    updates[1].prefix = "/three"; updates[1].session = 1; updates[1].seq = 7;
+    updates[2].prefix = "/two";   updates[2].session = 1; updates[2].seq = 3; // old sequence number
+
+    l1->addLocalNamesBatch (updates);
+    BOOST_CHECK_EQUAL (h1.m_map.size (), 0);
+    Simulator::Schedule (Seconds (1), &SyncLogicFixture::step7, this);
+  }
+
+  void
+  step7 ()
+  {
+    BOOST_CHECK_EQUAL (h1.m_map.size (), 0);
+    BOOST_CHECK_EQUAL (h2.m_map.size (), 2);
+    BOOST_CHECK_EQUAL (h2.m_map["/two"], 5);
+    BOOST_CHECK_EQUAL (h2.m_map["/three"], 7);
   }
   
 private: